@@ -4,30 +4,487 @@
 #include <linux/gpio/consumer.h>
 #include <linux/interrupt.h>
 #include <linux/input.h>
+#include <linux/input/matrix_keypad.h>
+#include <linux/bitmap.h>
 #include <linux/delay.h>
+#include <linux/hrtimer.h>
+#include <linux/ktime.h>
+#include <linux/property.h>
+#include <linux/spinlock.h>
+#include <linux/workqueue.h>
+
+/* 默认消抖窗口，可由 DT 属性 debounce-interval 覆盖 */
+#define MYKEYS_DEBOUNCE_MS  5
+/* 矩阵模式：驱动一列后等待行电平稳定的时间，可由 col-scan-delay-us 覆盖 */
+#define MYKEYS_SCAN_DELAY_US  2
+
+/* 每个按键独立的消抖状态 */
+struct mykeys_key {
+    unsigned short code;
+    int state;          /* 最近一次上报的值 */
+    bool debouncing;
+    ktime_t deadline;   /* 消抖窗口结束时间 */
+};
 
 struct mykeys_data {
-    struct gpio_desc *gpiod;
-    int irq;
     struct input_dev *input;
+    struct mykeys_key *keys;
+    unsigned int nkeys;
+
+    /*
+     * 软件消抖：第一个边沿立即上报，之后 debounce 时间内该键的抖动全部忽略，
+     * 窗口结束时再读一次电平补报。debounce 为 0 表示由 GPIO 控制器硬件消抖
+     * （或不消抖），每个边沿直接上报。
+     */
+    ktime_t debounce;
+
+    /* GPIO 模式：每个键一个 GPIO 和中断，在硬中断中处理 */
+    struct gpio_descs *gpios;
+    unsigned long *values;
+    spinlock_t lock;
+    struct hrtimer timer;
+
+    /* 矩阵模式：列输出、行输入，在 work 中扫描 */
+    struct gpio_descs *rows;
+    struct gpio_descs *cols;
+    unsigned int row_shift;
+    u32 scan_delay_us;
+    unsigned int poll_ms;
+    int *irqs;
+    unsigned int nirqs;
+    bool scanning;
+    struct delayed_work scan_work;
 };
 
-static irqreturn_t mykeys_irq_thread(int irq, void *dev_id)
+/*
+ * 按消抖状态处理一个键的新电平，需要上报则上报（不 sync），返回是否上报。
+ * 窗口内的变化都是抖动；窗口结束后电平与上报不一致（例如快速点按）就补报
+ * 并开始新的窗口。
+ */
+static bool mykeys_update(struct mykeys_data *data, struct mykeys_key *key,
+                          int value, ktime_t now)
+{
+    if (key->debouncing) {
+        if (ktime_before(now, key->deadline))
+            return false;
+        key->debouncing = false;
+    }
+
+    if (value == key->state)
+        return false;
+
+    key->state = value;
+    input_report_key(data->input, key->code, value);
+
+    if (data->debounce) {
+        key->debouncing = true;
+        key->deadline = ktime_add(now, data->debounce);
+    }
+
+    return true;
+}
+
+/* 最早结束的消抖窗口，没有则返回 KTIME_MAX */
+static ktime_t mykeys_next_deadline(struct mykeys_data *data)
+{
+    ktime_t next = KTIME_MAX;
+    unsigned int i;
+
+    for (i = 0; i < data->nkeys; i++)
+        if (data->keys[i].debouncing && ktime_before(data->keys[i].deadline, next))
+            next = data->keys[i].deadline;
+
+    return next;
+}
+
+/*
+ * GPIO 模式：一次读出所有键，同时变化的键合并成一次 input_sync。
+ * 持 data->lock 调用，返回下一个消抖窗口的结束时间。
+ */
+static ktime_t mykeys_gpio_scan(struct mykeys_data *data, ktime_t now)
+{
+    bool changed = false;
+    unsigned int i;
+
+    if (gpiod_get_array_value(data->gpios->ndescs, data->gpios->desc,
+                              data->gpios->info, data->values))
+        return mykeys_next_deadline(data);
+
+    input_set_timestamp(data->input, now);
+
+    for (i = 0; i < data->nkeys; i++)
+        changed |= mykeys_update(data, &data->keys[i],
+                                 test_bit(i, data->values), now);
+
+    if (changed)
+        input_sync(data->input);
+
+    return mykeys_next_deadline(data);
+}
+
+/* 硬中断中处理，不睡眠，按下延迟只有中断响应时间 */
+static irqreturn_t mykeys_irq(int irq, void *dev_id)
 {
     struct mykeys_data *data = dev_id;
-    int value;
+    unsigned long flags;
+    ktime_t next;
 
-    /* 简单消抖 */
-    msleep(10);
+    spin_lock_irqsave(&data->lock, flags);
 
-    value = gpiod_get_value(data->gpiod);
+    next = mykeys_gpio_scan(data, ktime_get());
+    if (next != KTIME_MAX)
+        hrtimer_start(&data->timer, next, HRTIMER_MODE_ABS);
 
-    input_report_key(data->input, KEY_ENTER, !value);
-    input_sync(data->input);
+    spin_unlock_irqrestore(&data->lock, flags);
 
     return IRQ_HANDLED;
 }
 
+/*
+ * 消抖窗口结束：重新扫描，还有窗口未结束则定到最早的那个。等锁期间
+ * mykeys_irq 可能已经 hrtimer_start 过，定时器已在队列中，不能再
+ * hrtimer_set_expires + RESTART，同样用 hrtimer_start 重新排队。
+ */
+static enum hrtimer_restart mykeys_debounce_timer(struct hrtimer *timer)
+{
+    struct mykeys_data *data = container_of(timer, struct mykeys_data, timer);
+    unsigned long flags;
+    ktime_t next;
+
+    spin_lock_irqsave(&data->lock, flags);
+
+    next = mykeys_gpio_scan(data, ktime_get());
+    if (next != KTIME_MAX)
+        hrtimer_start(timer, next, HRTIMER_MODE_ABS);
+
+    spin_unlock_irqrestore(&data->lock, flags);
+
+    return HRTIMER_NORESTART;
+}
+
+static void mykeys_cancel_timer(void *arg)
+{
+    struct mykeys_data *data = arg;
+
+    hrtimer_cancel(&data->timer);
+}
+
+/*
+ * 读取 debounce-interval（ms，0 表示不消抖）。GPIO 模式优先使用控制器
+ * 硬件消抖，只要有一个键不支持就全部退回软件消抖。
+ */
+static u32 mykeys_debounce_ms(struct device *dev, struct gpio_descs *gpios)
+{
+    u32 ms = MYKEYS_DEBOUNCE_MS;
+    unsigned int i;
+
+    device_property_read_u32(dev, "debounce-interval", &ms);
+    if (!ms || !gpios)
+        return ms;
+
+    for (i = 0; i < gpios->ndescs; i++)
+        if (gpiod_set_debounce(gpios->desc[i], ms * USEC_PER_MSEC))
+            return ms;
+
+    dev_dbg(dev, "hardware debounce %u ms\n", ms);
+    return 0;
+}
+
+/* key-gpios 与 linux,code 一一对应；只有一个键时 linux,code 可省略 */
+static int mykeys_gpio_probe(struct device *dev, struct mykeys_data *data)
+{
+    struct input_dev *input = data->input;
+    u32 *codes;
+    unsigned int i;
+    int count, irq, ret;
+
+    data->gpios = devm_gpiod_get_array(dev, "key", GPIOD_IN);
+    if (IS_ERR(data->gpios))
+        return dev_err_probe(dev, PTR_ERR(data->gpios),
+                             "failed to get key gpios\n");
+
+    data->nkeys = data->gpios->ndescs;
+
+    /* 中断上半部直接读电平，不支持会睡眠的 GPIO（如 I2C 扩展芯片） */
+    for (i = 0; i < data->nkeys; i++)
+        if (gpiod_cansleep(data->gpios->desc[i]))
+            return dev_err_probe(dev, -EINVAL,
+                                 "sleeping gpio not supported\n");
+
+    data->keys = devm_kcalloc(dev, data->nkeys, sizeof(*data->keys),
+                              GFP_KERNEL);
+    data->values = devm_bitmap_zalloc(dev, data->nkeys, GFP_KERNEL);
+    codes = devm_kcalloc(dev, data->nkeys, sizeof(*codes), GFP_KERNEL);
+    if (!data->keys || !data->values || !codes)
+        return -ENOMEM;
+
+    count = device_property_count_u32(dev, "linux,code");
+    if (count < 0 && data->nkeys == 1) {
+        codes[0] = KEY_ENTER;
+    } else if (count != data->nkeys) {
+        return dev_err_probe(dev, -EINVAL,
+                             "linux,code must list one code per key\n");
+    } else {
+        ret = device_property_read_u32_array(dev, "linux,code", codes,
+                                             count);
+        if (ret)
+            return ret;
+    }
+
+    __set_bit(EV_KEY, input->evbit); //type
+    for (i = 0; i < data->nkeys; i++) {
+        if (codes[i] > KEY_MAX)
+            return dev_err_probe(dev, -EINVAL, "invalid key code %u\n",
+                                 codes[i]);
+
+        data->keys[i].code = codes[i];
+        __set_bit(codes[i], input->keybit); //code
+    }
+
+    data->debounce = ms_to_ktime(mykeys_debounce_ms(dev, data->gpios));
+
+    hrtimer_init(&data->timer, CLOCK_MONOTONIC, HRTIMER_MODE_ABS);
+    data->timer.function = mykeys_debounce_timer;
+
+    /* 先于中断注册，释放时在中断之后取消定时器 */
+    ret = devm_add_action_or_reset(dev, mykeys_cancel_timer, data);
+    if (ret)
+        return ret;
+
+    ret = input_register_device(input);
+    if (ret)
+        return ret;
+
+    /* 上报初始状态，之后只在变化时上报 */
+    spin_lock_irq(&data->lock);
+    mykeys_gpio_scan(data, ktime_get());
+    spin_unlock_irq(&data->lock);
+
+    /* 申请中断：每个键一个，共用同一个硬中断处理，无线程、无睡眠 */
+    for (i = 0; i < data->nkeys; i++) {
+        irq = gpiod_to_irq(data->gpios->desc[i]);
+        if (irq < 0)
+            return irq;
+
+        ret = devm_request_irq(dev, irq, mykeys_irq,
+                               IRQF_TRIGGER_FALLING | IRQF_TRIGGER_RISING,
+                               "my-gpio-key", data);
+        if (ret)
+            return ret;
+    }
+
+    return 0;
+}
+
+static void mykeys_matrix_enable_irqs(struct mykeys_data *data, bool enable)
+{
+    unsigned int i;
+
+    for (i = 0; i < data->nirqs; i++) {
+        if (enable)
+            enable_irq(data->irqs[i]);
+        else
+            disable_irq_nosync(data->irqs[i]);
+    }
+}
+
+static void mykeys_matrix_set_cols(struct mykeys_data *data, int value)
+{
+    unsigned int c;
+
+    for (c = 0; c < data->cols->ndescs; c++)
+        gpiod_set_value_cansleep(data->cols->desc[c], value);
+}
+
+/*
+ * 矩阵模式：逐列驱动有效电平读出所有行，整个矩阵的变化合并成一次
+ * input_sync。有键按下或仍在消抖时定时重扫（按下时所有列有效，行上
+ * 看不出松开），全部松开后所有列恢复有效、重新打开行中断等待下一次按键。
+ */
+static void mykeys_matrix_scan(struct work_struct *work)
+{
+    struct mykeys_data *data = container_of(work, struct mykeys_data,
+                                            scan_work.work);
+    unsigned int nrows = data->rows->ndescs, ncols = data->cols->ndescs;
+    DECLARE_BITMAP(rowbits, MATRIX_MAX_ROWS);
+    ktime_t now = ktime_get();
+    bool changed = false, held = false;
+    struct mykeys_key *key;
+    unsigned int r, c;
+    int ret;
+
+    input_set_timestamp(data->input, now);
+
+    mykeys_matrix_set_cols(data, 0);
+
+    for (c = 0; c < ncols; c++) {
+        gpiod_set_value_cansleep(data->cols->desc[c], 1);
+        fsleep(data->scan_delay_us);
+
+        ret = gpiod_get_array_value_cansleep(nrows, data->rows->desc,
+                                             data->rows->info, rowbits);
+        gpiod_set_value_cansleep(data->cols->desc[c], 0);
+        if (ret) {
+            /* 读失败按整列保持原状态，稍后重扫 */
+            held = true;
+            continue;
+        }
+
+        for (r = 0; r < nrows; r++) {
+            key = &data->keys[r * ncols + c];
+            changed |= mykeys_update(data, key, test_bit(r, rowbits), now);
+            held |= key->state || key->debouncing;
+        }
+    }
+
+    if (changed)
+        input_sync(data->input);
+
+    mykeys_matrix_set_cols(data, 1);
+
+    if (held) {
+        schedule_delayed_work(&data->scan_work,
+                              msecs_to_jiffies(data->poll_ms));
+        return;
+    }
+
+    spin_lock_irq(&data->lock);
+    data->scanning = false;
+    mykeys_matrix_enable_irqs(data, true);
+    spin_unlock_irq(&data->lock);
+}
+
+/* 任一行有效：关掉行中断，交给 work 扫描 */
+static irqreturn_t mykeys_matrix_irq(int irq, void *dev_id)
+{
+    struct mykeys_data *data = dev_id;
+    unsigned long flags;
+
+    spin_lock_irqsave(&data->lock, flags);
+
+    if (!data->scanning) {
+        data->scanning = true;
+        mykeys_matrix_enable_irqs(data, false);
+        schedule_delayed_work(&data->scan_work, 0);
+    }
+
+    spin_unlock_irqrestore(&data->lock, flags);
+
+    return IRQ_HANDLED;
+}
+
+static void mykeys_matrix_stop(void *arg)
+{
+    struct mykeys_data *data = arg;
+
+    disable_delayed_work_sync(&data->scan_work);
+}
+
+/*
+ * row-gpios / col-gpios 组成矩阵，linux,keymap 给出每个位置的键值
+ * （MATRIX_KEY(row, col, code)）。默认每行一个中断；若 DT 提供
+ * interrupts（例如各行经二极管线或到一个引脚），则只用这一个中断。
+ */
+static int mykeys_matrix_probe(struct platform_device *pdev,
+                               struct mykeys_data *data)
+{
+    struct device *dev = &pdev->dev;
+    const unsigned short *keycode;
+    unsigned int nrows, ncols, r, c, i;
+    u32 debounce_ms;
+    int irq, ret;
+
+    data->rows = devm_gpiod_get_array(dev, "row", GPIOD_IN);
+    if (IS_ERR(data->rows))
+        return dev_err_probe(dev, PTR_ERR(data->rows),
+                             "failed to get row gpios\n");
+
+    /* 空闲时所有列有效，任一键按下都会拉动所在行 */
+    data->cols = devm_gpiod_get_array(dev, "col", GPIOD_OUT_HIGH);
+    if (IS_ERR(data->cols))
+        return dev_err_probe(dev, PTR_ERR(data->cols),
+                             "failed to get col gpios\n");
+
+    nrows = data->rows->ndescs;
+    ncols = data->cols->ndescs;
+    if (nrows > MATRIX_MAX_ROWS || ncols > MATRIX_MAX_COLS)
+        return dev_err_probe(dev, -EINVAL, "matrix too large\n");
+
+    data->row_shift = get_count_order(ncols);
+    data->nkeys = nrows * ncols;
+
+    data->keys = devm_kcalloc(dev, data->nkeys, sizeof(*data->keys),
+                              GFP_KERNEL);
+    if (!data->keys)
+        return -ENOMEM;
+
+    ret = matrix_keypad_build_keymap(NULL, NULL, nrows, ncols, NULL,
+                                     data->input);
+    if (ret)
+        return dev_err_probe(dev, ret, "failed to build keymap\n");
+
+    keycode = data->input->keycode;
+    for (r = 0; r < nrows; r++)
+        for (c = 0; c < ncols; c++)
+            data->keys[r * ncols + c].code =
+                keycode[MATRIX_SCAN_CODE(r, c, data->row_shift)];
+
+    /* 扫描式无法使用硬件消抖 */
+    debounce_ms = mykeys_debounce_ms(dev, NULL);
+    data->debounce = ms_to_ktime(debounce_ms);
+    data->poll_ms = debounce_ms ?: MYKEYS_DEBOUNCE_MS;
+
+    data->scan_delay_us = MYKEYS_SCAN_DELAY_US;
+    device_property_read_u32(dev, "col-scan-delay-us", &data->scan_delay_us);
+
+    INIT_DELAYED_WORK(&data->scan_work, mykeys_matrix_scan);
+
+    irq = platform_get_irq_optional(pdev, 0);
+    if (irq > 0) {
+        data->nirqs = 1;
+    } else if (irq == -ENXIO) {
+        data->nirqs = nrows;
+    } else {
+        return irq;
+    }
+
+    data->irqs = devm_kcalloc(dev, data->nirqs, sizeof(*data->irqs),
+                              GFP_KERNEL);
+    if (!data->irqs)
+        return -ENOMEM;
+
+    for (i = 0; i < data->nirqs; i++) {
+        data->irqs[i] = irq > 0 ? irq : gpiod_to_irq(data->rows->desc[i]);
+        if (data->irqs[i] < 0)
+            return data->irqs[i];
+    }
+
+    ret = input_register_device(data->input);
+    if (ret)
+        return ret;
+
+    /* 中断先保持关闭，由第一次扫描（读取初始状态）结束后打开 */
+    data->scanning = true;
+
+    for (i = 0; i < data->nirqs; i++) {
+        ret = devm_request_irq(dev, data->irqs[i], mykeys_matrix_irq,
+                               IRQF_TRIGGER_FALLING | IRQF_TRIGGER_RISING |
+                               IRQF_NO_AUTOEN,
+                               "my-gpio-key", data);
+        if (ret)
+            return ret;
+    }
+
+    /* 晚于中断注册，释放时先于中断停止扫描，之后不会再打开中断 */
+    ret = devm_add_action_or_reset(dev, mykeys_matrix_stop, data);
+    if (ret)
+        return ret;
+
+    schedule_delayed_work(&data->scan_work, 0);
+
+    return 0;
+}
+
 static int mykeys_probe(struct platform_device *pdev)
 {
     struct mykeys_data *data;
@@ -37,16 +494,7 @@ static int mykeys_probe(struct platform_device *pdev)
     if (!data)
         return -ENOMEM;
 
-    /* 获取 GPIO */
-    data->gpiod = devm_gpiod_get(&pdev->dev, "key", GPIOD_IN);
-    if (IS_ERR(data->gpiod))
-        return dev_err_probe(&pdev->dev, PTR_ERR(data->gpiod),
-                             "failed to get key gpio\n");
-
-    /* GPIO 转 IRQ */
-    data->irq = gpiod_to_irq(data->gpiod);
-    if (data->irq < 0)
-        return data->irq;
+    spin_lock_init(&data->lock);
 
     /* 申请 input 设备 */
     data->input = devm_input_allocate_device(&pdev->dev);
@@ -57,27 +505,17 @@ static int mykeys_probe(struct platform_device *pdev)
     data->input->phys = "my-gpio-key/input0";
     data->input->id.bustype = BUS_HOST;
 
-    __set_bit(EV_KEY, data->input->evbit); //type 
-    __set_bit(KEY_ENTER, data->input->keybit); //code
-
-    ret = input_register_device(data->input);
-    if (ret)
-        return ret;
-
-    /* 申请中断 */
-    ret = devm_request_threaded_irq(&pdev->dev,
-                                    data->irq,
-                                    NULL,
-                                    mykeys_irq_thread,
-                                    IRQF_TRIGGER_FALLING | IRQF_TRIGGER_RISING | IRQF_ONESHOT,
-                                    "my-gpio-key",
-                                    data);
+    /* 有 row-gpios 时为矩阵模式，否则每个键一个 GPIO */
+    if (device_property_present(&pdev->dev, "row-gpios"))
+        ret = mykeys_matrix_probe(pdev, data);
+    else
+        ret = mykeys_gpio_probe(&pdev->dev, data);
     if (ret)
         return ret;
 
     platform_set_drvdata(pdev, data);
 
-    dev_info(&pdev->dev, "GPIO key driver loaded\n");
+    dev_info(&pdev->dev, "GPIO key driver loaded, %u keys\n", data->nkeys);
 
     return 0;
 }
@@ -12,13 +12,46 @@ struct bmi270_chip_info {
 	const char *fw_name;
 };
 
+#define BMI270_MAX_REGISTER	0x7e
+/* Longest sample data burst: accelerometer, gyroscope and sensortime */
+#define BMI270_DATA_BURST_LEN	15
+/* Longest FIFO_DATA read: the whole FIFO and a trailing sensortime frame */
+#define BMI270_FIFO_READ_MAX	(6144 + 1 + 3)
+
+struct bmi270_transport;
+
+/*
+ * Optional fast path a transport can offer for the sample data, bypassing
+ * regmap. Calls are serialised by the core and made with the device
+ * resumed.
+ */
+struct bmi270_transport_ops {
+	/* Pre-build the @len byte read from @reg that stream_read() issues */
+	int (*stream_prepare)(struct bmi270_transport *tr, unsigned int reg,
+			      size_t len);
+	int (*stream_read)(struct bmi270_transport *tr, void *buf);
+	/* Read @len bytes from the non-incrementing register @reg */
+	int (*fifo_read)(struct bmi270_transport *tr, unsigned int reg,
+			 void *buf, size_t len);
+};
+
+/* Embedded in the transport's own state, see container_of() */
+struct bmi270_transport {
+	const struct bmi270_transport_ops *ops;
+	/* Longest fifo_read() that goes out as a single bus transaction */
+	size_t fifo_read_max;
+};
+
 extern const struct regmap_config bmi270_regmap_config;
+extern const struct regmap_access_table bmi270_volatile_table;
+extern const struct regmap_access_table bmi270_precious_table;
 extern const struct bmi270_chip_info bmi260_chip_info;
 extern const struct bmi270_chip_info bmi270_chip_info;
 
 struct device;
 int bmi270_core_probe(struct device *dev, struct regmap *regmap,
-		      const struct bmi270_chip_info *chip_info);
+		      const struct bmi270_chip_info *chip_info,
+		      struct bmi270_transport *transport);
 
 extern const struct dev_pm_ops bmi270_core_pm_ops;
 
@@ -1,12 +1,20 @@
 // SPDX-License-Identifier: (GPL-2.0-only OR BSD-2-Clause)
 
 #include <linux/bitfield.h>
+#include <linux/completion.h>
+#include <linux/debugfs.h>
 #include <linux/firmware.h>
 #include <linux/i2c.h>
+#include <linux/log2.h>
 #include <linux/module.h>
 #include <linux/mutex.h>
+#include <linux/pm_runtime.h>
 #include <linux/regmap.h>
+#include <linux/seq_file.h>
+#include <linux/timekeeping.h>
+#include <linux/unaligned.h>
 #include <linux/units.h>
+#include <linux/workqueue.h>
 
 #include <linux/iio/events.h>
 #include <linux/iio/iio.h>
@@ -26,34 +34,64 @@
 #define BMI270_CHIP_ID_VAL				0x24
 #define BMI270_CHIP_ID_MSK				GENMASK(7, 0)
 
+#define BMI270_ERR_REG					0x02
+
+#define BMI270_STATUS_REG				0x03
+#define BMI270_STATUS_DRDY_GYR_MSK			BIT(6)
+#define BMI270_STATUS_DRDY_ACC_MSK			BIT(7)
+
 #define BMI270_ACCEL_X_REG				0x0c
 #define BMI270_ANG_VEL_X_REG				0x12
 
+#define BMI270_SENSORTIME_0_REG				0x18
+#define BMI270_SENSORTIME_MSK				GENMASK(23, 0)
+
 #define BMI270_INT_STATUS_0_REG				0x1c
 #define BMI270_INT_STATUS_0_STEP_CNT_MSK		BIT(1)
 #define BMI270_INT_STATUS_0_NOMOTION_MSK		BIT(5)
 #define BMI270_INT_STATUS_0_MOTION_MSK			BIT(6)
 
 #define BMI270_INT_STATUS_1_REG				0x1d
+#define BMI270_INT_STATUS_1_FFULL_MSK			BIT(0)
+#define BMI270_INT_STATUS_1_FWM_MSK			BIT(1)
 #define BMI270_INT_STATUS_1_ACC_GYR_DRDY_MSK		GENMASK(7, 6)
 
+#define BMI270_EVENT_REG				0x1b
+
 #define BMI270_SC_OUT_0_REG				0x1e
 
 #define BMI270_INTERNAL_STATUS_REG			0x21
 #define BMI270_INTERNAL_STATUS_MSG_MSK			GENMASK(3, 0)
+#define BMI270_INTERNAL_STATUS_MSG_NOT_INIT		0x00
 #define BMI270_INTERNAL_STATUS_MSG_INIT_OK		0x01
 #define BMI270_INTERNAL_STATUS_AXES_REMAP_ERR_MSK	BIT(5)
 #define BMI270_INTERNAL_STATUS_ODR_50HZ_ERR_MSK		BIT(6)
 
 #define BMI270_TEMPERATURE_0_REG			0x22
+#define BMI270_TEMPERATURE_1_REG			0x23
+/* 0x8000 is reported until the first conversion after power up */
+#define BMI270_TEMPERATURE_INVALID_MSB			0x80
+
+#define BMI270_FIFO_LENGTH_0_REG			0x24
+#define BMI270_FIFO_LENGTH_MSK				GENMASK(13, 0)
+
+#define BMI270_FIFO_DATA_REG				0x26
 
 #define BMI270_FEAT_PAGE_REG				0x2f
+#define BMI270_FEAT_PAGE_MSK				GENMASK(2, 0)
+#define BMI270_FEAT_DATA_START_REG			0x30
+#define BMI270_FEAT_DATA_END_REG			0x3f
+#define BMI270_FEAT_DATA_WORDS				8
 
 #define BMI270_ACC_CONF_REG				0x40
 #define BMI270_ACC_CONF_ODR_MSK				GENMASK(3, 0)
+#define BMI270_ACC_CONF_ODR_0_78HZ			0x01
+#define BMI270_ACC_CONF_ODR_12_5HZ			0x05
 #define BMI270_ACC_CONF_ODR_100HZ			0x08
 #define BMI270_ACC_CONF_BWP_MSK				GENMASK(6, 4)
 #define BMI270_ACC_CONF_BWP_NORMAL_MODE			0x02
+/* In low power mode BWP averages 2^BWP samples */
+#define BMI270_ACC_CONF_BWP_AVG_MAX			0x07
 #define BMI270_ACC_CONF_FILTER_PERF_MSK			BIT(7)
 
 #define BMI270_ACC_CONF_RANGE_REG			0x41
@@ -61,6 +99,7 @@
 
 #define BMI270_GYR_CONF_REG				0x42
 #define BMI270_GYR_CONF_ODR_MSK				GENMASK(3, 0)
+#define BMI270_GYR_CONF_ODR_25HZ			0x06
 #define BMI270_GYR_CONF_ODR_200HZ			0x09
 #define BMI270_GYR_CONF_BWP_MSK				GENMASK(5, 4)
 #define BMI270_GYR_CONF_BWP_NORMAL_MODE			0x02
@@ -70,6 +109,19 @@
 #define BMI270_GYR_CONF_RANGE_REG			0x43
 #define BMI270_GYR_CONF_RANGE_MSK			GENMASK(2, 0)
 
+#define BMI270_FIFO_WTM_0_REG				0x46
+#define BMI270_FIFO_WTM_MSK				GENMASK(12, 0)
+
+#define BMI270_FIFO_CONFIG_0_REG			0x48
+#define BMI270_FIFO_CONFIG_0_STOP_ON_FULL_MSK		BIT(0)
+#define BMI270_FIFO_CONFIG_0_TIME_EN_MSK		BIT(1)
+
+#define BMI270_FIFO_CONFIG_1_REG			0x49
+#define BMI270_FIFO_CONFIG_1_HEADER_EN_MSK		BIT(4)
+#define BMI270_FIFO_CONFIG_1_AUX_EN_MSK			BIT(5)
+#define BMI270_FIFO_CONFIG_1_ACC_EN_MSK			BIT(6)
+#define BMI270_FIFO_CONFIG_1_GYR_EN_MSK			BIT(7)
+
 #define BMI270_INT1_IO_CTRL_REG				0x53
 #define BMI270_INT2_IO_CTRL_REG				0x54
 #define BMI270_INT_IO_CTRL_LVL_MSK			BIT(1)
@@ -87,14 +139,44 @@
 #define BMI270_INT_MAP_FEAT_ANYMOTION_MSK		BIT(6)
 
 #define BMI270_INT_MAP_DATA_REG				0x58
+#define BMI270_INT_MAP_DATA_FFULL_INT1_MSK		BIT(0)
+#define BMI270_INT_MAP_DATA_FWM_INT1_MSK		BIT(1)
 #define BMI270_INT_MAP_DATA_DRDY_INT1_MSK		BIT(2)
+#define BMI270_INT_MAP_DATA_FFULL_INT2_MSK		BIT(4)
+#define BMI270_INT_MAP_DATA_FWM_INT2_MSK		BIT(5)
 #define BMI270_INT_MAP_DATA_DRDY_INT2_MSK		BIT(6)
 
 #define BMI270_INIT_CTRL_REG				0x59
 #define BMI270_INIT_CTRL_LOAD_DONE_MSK			BIT(0)
 
+#define BMI270_INIT_ADDR_0_REG				0x5b
+#define BMI270_INIT_ADDR_0_MSK				GENMASK(3, 0)
+#define BMI270_INIT_ADDR_1_MSK				GENMASK(11, 4)
+
 #define BMI270_INIT_DATA_REG				0x5e
 
+#define BMI270_INTERNAL_ERROR_REG			0x5f
+
+#define BMI270_NV_CONF_REG				0x70
+#define BMI270_NV_CONF_ACC_OFF_EN_MSK			BIT(3)
+
+/* 3.9mg per LSB, i.e. 1/256 g */
+#define BMI270_ACC_OFFSET_X_REG				0x71
+/* Low 8 of 10 bits, 0.061dps per LSB */
+#define BMI270_GYR_OFFSET_X_REG				0x74
+#define BMI270_OFFSET_6_REG				0x77
+/* Top 2 bits of each gyroscope offset, X at bits 1:0 */
+#define BMI270_OFFSET_6_GYR_MSB_MSK			GENMASK(1, 0)
+#define BMI270_OFFSET_6_GYR_OFF_EN_MSK			BIT(6)
+#define BMI270_ACC_OFFSET_BITS				8
+#define BMI270_ACC_OFFSET_MIN				-128
+#define BMI270_ACC_OFFSET_MAX				127
+#define BMI270_GYR_OFFSET_BITS				10
+#define BMI270_GYR_OFFSET_MIN				-512
+#define BMI270_GYR_OFFSET_MAX				511
+/* Samples averaged by fast offset compensation */
+#define BMI270_FOC_SAMPLES				64
+
 #define BMI270_PWR_CONF_REG				0x7c
 #define BMI270_PWR_CONF_ADV_PWR_SAVE_MSK		BIT(0)
 #define BMI270_PWR_CONF_FIFO_WKUP_MSK			BIT(1)
@@ -105,6 +187,10 @@
 #define BMI270_PWR_CTRL_GYR_EN_MSK			BIT(1)
 #define BMI270_PWR_CTRL_ACCEL_EN_MSK			BIT(2)
 #define BMI270_PWR_CTRL_TEMP_EN_MSK			BIT(3)
+#define BMI270_PWR_CTRL_BLOCKS				4
+
+#define BMI270_CMD_REG					0x7e
+#define BMI270_CMD_FIFO_FLUSH				0xb0
 
 #define BMI270_STEP_SC26_WTRMRK_MSK			GENMASK(9, 0)
 #define BMI270_STEP_SC26_RST_CNT_MSK			BIT(10)
@@ -137,65 +223,253 @@
 #define BMI270_STEP_COUNTER_FACTOR			20
 #define BMI270_STEP_COUNTER_MAX				20460
 
+/* See the FIFO chapter of the datasheet, headered mode is used */
+#define BMI270_FIFO_SIZE				6144
+#define BMI270_FIFO_HEADER_MODE_MSK			GENMASK(7, 6)
+#define BMI270_FIFO_HEADER_MODE_CTRL			0x01
+#define BMI270_FIFO_HEADER_MODE_DATA			0x02
+#define BMI270_FIFO_HEADER_PARM_MSK			GENMASK(5, 2)
+#define BMI270_FIFO_HEADER_PARM_SKIP			0x00
+#define BMI270_FIFO_HEADER_PARM_SENSORTIME		0x01
+#define BMI270_FIFO_HEADER_PARM_INPUT_CFG		0x02
+#define BMI270_FIFO_HEADER_ACC_MSK			BIT(2)
+#define BMI270_FIFO_HEADER_GYR_MSK			BIT(3)
+#define BMI270_FIFO_HEADER_AUX_MSK			BIT(4)
+#define BMI270_FIFO_SKIP_LEN				1
+#define BMI270_FIFO_SENSORTIME_LEN			3
+#define BMI270_FIFO_INPUT_CFG_LEN			4
+#define BMI270_FIFO_AUX_LEN				8
+#define BMI270_FIFO_ACC_GYR_LEN				6
+/* Header byte plus one accelerometer and one gyroscope sample */
+#define BMI270_FIFO_FRAME_LEN				13
+/*
+ * Half of BMI270_FIFO_SIZE / BMI270_FIFO_FRAME_LEN: the other half absorbs
+ * the interrupt being served late, so a late drain does not overflow
+ */
+#define BMI270_FIFO_WATERMARK_MAX			236
+
+/* SENSORTIME, closing the data burst read by the trigger handler */
+#define BMI270_SENSORTIME_LEN				3
+/* SC_OUT up to TEMPERATURE, read together when both are due */
+#define BMI270_SLOW_BURST_LEN				6
+#define BMI270_DECIMATION_MAX				1000
+
+/* The sensortime counter ticks at 25.6kHz, i.e. every 39.0625us */
+#define BMI270_SENSORTIME_HZ				25600
+#define BMI270_SENSORTIME_TICK_PS			39062500
+/* Largest oscillator error accepted by the sensortime model, 2% */
+#define BMI270_SENSORTIME_MAX_DRIFT_PS			781250
+/* Restart the model when a sample lands this far off its prediction */
+#define BMI270_SENSORTIME_RESYNC_NS			(50 * NSEC_PER_MSEC)
+/* Fraction of each prediction error fed back into offset and rate */
+#define BMI270_SENSORTIME_PHASE_GAIN			8
+#define BMI270_SENSORTIME_FREQ_GAIN			64
+
 #define BMI270_INT_MICRO_TO_RAW(val, val2, scale) \
 	((val) * (scale) + ((val2) * (scale)) / MEGA)
 #define BMI270_RAW_TO_MICRO(raw, scale) \
 	((((raw) % (scale)) * MEGA) / scale)
 
+#define BMI270_AUTOSUSPEND_DELAY_MS			2000
+/* Gyroscope start-up from suspend takes up to 45ms */
+#define BMI270_WAKE_POLL_US				500
+#define BMI270_WAKE_TIMEOUT_US				100000
+
+/* Table C of the datasheet allows up to 140ms for the config to load */
+#define BMI270_INIT_POLL_US				1000
+#define BMI270_INIT_TIMEOUT_US				200000
+
 #define BMI260_INIT_DATA_FILE "bmi260-init-data.fw"
 #define BMI270_INIT_DATA_FILE "bmi270-init-data.fw"
 
+enum bmi270_feature_reg_id {
+	/* Page 1 registers */
+	BMI270_ANYMO1_REG,
+	BMI270_ANYMO2_REG,
+	/* Page 2 registers */
+	BMI270_NOMO1_REG,
+	BMI270_NOMO2_REG,
+	/* Page 6 registers */
+	BMI270_SC_26_REG,
+	BMI270_NUM_FEATURE_REGS,
+};
+
+/* Accel and gyro follow the order of their data registers */
+enum bmi270_scan {
+	BMI270_SCAN_ACCEL_X,
+	BMI270_SCAN_ACCEL_Y,
+	BMI270_SCAN_ACCEL_Z,
+	BMI270_SCAN_GYRO_X,
+	BMI270_SCAN_GYRO_Y,
+	BMI270_SCAN_GYRO_Z,
+	BMI270_SCAN_TEMP,
+	BMI270_SCAN_STEPS,
+	BMI270_SCAN_TIMESTAMP,
+};
+
+#define BMI270_SCAN_ACCEL_MSK	GENMASK(BMI270_SCAN_ACCEL_Z, BMI270_SCAN_ACCEL_X)
+#define BMI270_SCAN_GYRO_MSK	GENMASK(BMI270_SCAN_GYRO_Z, BMI270_SCAN_GYRO_X)
+
+/*
+ * Linear model mapping the device sensortime counter onto CLOCK_BOOTTIME.
+ * Counter values are unwrapped from 24 to 64 bits.
+ */
+struct bmi270_sensortime {
+	u32 raw;
+	s64 ticks;
+	s64 anchor_ticks;
+	s64 anchor_ns;
+	s64 tick_ps;
+	s64 last_ns;
+	bool valid;
+};
+
 enum bmi270_irq_pin {
 	BMI270_IRQ_DISABLED,
 	BMI270_IRQ_INT1,
 	BMI270_IRQ_INT2,
 };
 
+enum bmi270_sensor_type {
+	BMI270_ACCEL	= 0,
+	BMI270_GYRO,
+	BMI270_TEMP,
+};
+
+enum bmi270_power_mode {
+	BMI270_LOW_POWER,
+	BMI270_PERFORMANCE,
+};
+
+/* Performance mode oversampling ratios 1, 2 and 4 */
+#define BMI270_PERF_OSR_NUM				3
+
+enum bmi270_event {
+	BMI270_EVENT_ANYMO_X,
+	BMI270_EVENT_ANYMO_Y,
+	BMI270_EVENT_ANYMO_Z,
+	BMI270_EVENT_NOMO,
+	BMI270_EVENT_STEP_WTRMRK,
+};
+
 struct bmi270_data {
 	struct device *dev;
 	struct regmap *regmap;
+	/* Transport fast path for sample data, NULL to go through regmap */
+	struct bmi270_transport *transport;
 	const struct bmi270_chip_info *chip_info;
+	/* Pin carrying data ready and FIFO interrupts */
 	enum bmi270_irq_pin irq_pin;
+	/* Pin carrying feature (motion, step) interrupts, may equal irq_pin */
+	enum bmi270_irq_pin feat_pin;
+	bool int_latch;
 	struct iio_trigger *trig;
 	 /* Protect device's private data from concurrent access */
 	struct mutex mutex;
+	/*
+	 * Protects the sample path (trigger handler, FIFO drain) and the
+	 * scan, FIFO and sensortime state it uses, so that configuration
+	 * under 'mutex' does not stall streaming. Nests inside 'mutex'.
+	 */
+	struct mutex data_lock;
+	/*
+	 * The config file is uploaded asynchronously after probe. Until that
+	 * is done init_status is -EAGAIN, afterwards it holds the outcome.
+	 */
+	int init_status;
+	struct completion init_done;
+	/* Config file upload statistics, reported in debugfs */
+	unsigned int init_chunk;
+	size_t init_bytes;
+	u64 init_upload_ns;
 	bool steps_enabled;
+	/*
+	 * Enabled events, each holding a runtime PM reference and one on the
+	 * accelerometer
+	 */
+	unsigned long events_enabled;
+	/* Users of each PWR_CTRL sensor block, indexed by bit */
+	unsigned int pwr_refs[BMI270_PWR_CTRL_BLOCKS];
+	/* Sensor blocks held by the running buffer */
+	unsigned long buffer_blocks;
+	/* Sensor blocks raw reads woke, held until raw_work */
+	unsigned long raw_blocks;
+	struct delayed_work raw_work;
+	/* Runtime resume to first sample, reported in debugfs */
+	u64 wake_latency_ns;
+	u64 wake_latency_max_ns;
+	bool fifo_mode;
+	bool fifo_drained;
+	/* Longest FIFO_DATA read the bus does in one transaction */
+	unsigned int fifo_read_max;
+	unsigned int watermark;
+	/* Sensortime ticks between two samples at the fastest active ODR */
+	unsigned int frame_ticks;
+	s64 fifo_next_ticks;
+	/* CLOCK_BOOTTIME of the last interrupt, taken in hard IRQ context */
+	s64 irq_tstamp;
+	struct bmi270_sensortime sensortime;
+	/*
+	 * Shadow of the paged feature registers. regmap cannot cache them as
+	 * they all share the 0x30-0x3f window.
+	 */
+	u16 feat_cache[BMI270_NUM_FEATURE_REGS];
+	unsigned long feat_cached;
+	/* Latest value of every scan channel, indexed by enum bmi270_scan */
+	__le16 samples[BMI270_SCAN_TIMESTAMP];
+	/*
+	 * Layout of the active scan, set up at buffer preenable: the sample
+	 * feeding each slot, and the register window read per trigger.
+	 */
+	u8 scan_src[BMI270_SCAN_TIMESTAMP];
+	unsigned int scan_len;
+	unsigned int burst_first;
+	unsigned int burst_len;
+	/*
+	 * Temperature and step count change slowly, so they are only read
+	 * every temp_decim and steps_decim samples respectively.
+	 */
+	bool temp_en;
+	bool steps_en;
+	unsigned int temp_decim;
+	unsigned int steps_decim;
+	unsigned int temp_count;
+	unsigned int steps_count;
+	/* FIFO_CONFIG_1 sensor enables and resulting data frame length */
+	unsigned int fifo_sensors;
+	unsigned int fifo_frame_len;
 
 	/*
 	 * Where IIO_DMA_MINALIGN may be larger than 8 bytes, align to
 	 * that to ensure a DMA safe buffer.
 	 */
 	struct {
-		__le16 channels[6];
+		__le16 channels[BMI270_SCAN_TIMESTAMP];
 		aligned_s64 timestamp;
 	} buffer __aligned(IIO_DMA_MINALIGN);
 	/*
-	 * Variable to access feature registers. It can be accessed concurrently
-	 * with the 'buffer' variable
+	 * Bounce buffer for one page of the feature register window. It can
+	 * be accessed concurrently with the 'buffer' variable
 	 */
-	__le16 regval __aligned(IIO_DMA_MINALIGN);
-};
-
-enum bmi270_scan {
-	BMI270_SCAN_ACCEL_X,
-	BMI270_SCAN_ACCEL_Y,
-	BMI270_SCAN_ACCEL_Z,
-	BMI270_SCAN_GYRO_X,
-	BMI270_SCAN_GYRO_Y,
-	BMI270_SCAN_GYRO_Z,
-	BMI270_SCAN_TIMESTAMP,
+	__le16 feat_buf[BMI270_FEAT_DATA_WORDS] __aligned(IIO_DMA_MINALIGN);
+	u8 burst[BMI270_DATA_BURST_LEN] __aligned(IIO_DMA_MINALIGN);
+	u8 slow_burst[BMI270_SLOW_BURST_LEN] __aligned(IIO_DMA_MINALIGN);
+	/* INT_STATUS_0/1, read together when both share a pin */
+	u8 int_status[2] __aligned(IIO_DMA_MINALIGN);
+	/* INIT_ADDR_0/1 word offset of the next config file chunk */
+	u8 init_addr[2] __aligned(IIO_DMA_MINALIGN);
+	/* One accelerometer or gyroscope sample read during FOC */
+	__le16 foc_sample[3] __aligned(IIO_DMA_MINALIGN);
+	/*
+	 * Raw FIFO contents, drained in one burst by bmi270_fifo_drain(). Room
+	 * is left for the sensortime frame that follows the last data frame.
+	 */
+	u8 fifo_buf[BMI270_FIFO_SIZE + 1 + BMI270_FIFO_SENSORTIME_LEN]
+		__aligned(IIO_DMA_MINALIGN);
 };
 
-static const unsigned long bmi270_avail_scan_masks[] = {
-	(BIT(BMI270_SCAN_ACCEL_X) |
-	 BIT(BMI270_SCAN_ACCEL_Y) |
-	 BIT(BMI270_SCAN_ACCEL_Z) |
-	 BIT(BMI270_SCAN_GYRO_X)  |
-	 BIT(BMI270_SCAN_GYRO_Y)  |
-	 BIT(BMI270_SCAN_GYRO_Z)  |
-	 BIT(BMI270_SCAN_TIMESTAMP)),
-	0
-};
+static_assert(BMI270_FIFO_READ_MAX ==
+	      BMI270_FIFO_SIZE + 1 + BMI270_FIFO_SENSORTIME_LEN);
 
 const struct bmi270_chip_info bmi260_chip_info = {
 	.name = "bmi260",
@@ -211,11 +485,34 @@ const struct bmi270_chip_info bmi270_chip_info = {
 };
 EXPORT_SYMBOL_GPL(bmi270_chip_info);
 
-enum bmi270_sensor_type {
-	BMI270_ACCEL	= 0,
-	BMI270_GYRO,
-	BMI270_TEMP,
+/*
+ * Status, data and FIFO registers change behind our back. The feature
+ * window is paged, so it is shadowed separately in struct bmi270_data.
+ */
+static const struct regmap_range bmi270_volatile_ranges[] = {
+	regmap_reg_range(BMI270_ERR_REG, BMI270_FEAT_PAGE_REG - 1),
+	regmap_reg_range(BMI270_FEAT_DATA_START_REG, BMI270_FEAT_DATA_END_REG),
+	regmap_reg_range(BMI270_INIT_ADDR_0_REG, BMI270_INTERNAL_ERROR_REG),
+	regmap_reg_range(BMI270_CMD_REG, BMI270_CMD_REG),
+};
+
+const struct regmap_access_table bmi270_volatile_table = {
+	.yes_ranges = bmi270_volatile_ranges,
+	.n_yes_ranges = ARRAY_SIZE(bmi270_volatile_ranges),
 };
+EXPORT_SYMBOL_GPL(bmi270_volatile_table);
+
+/* Reading these clears them */
+static const struct regmap_range bmi270_precious_ranges[] = {
+	regmap_reg_range(BMI270_EVENT_REG, BMI270_INT_STATUS_1_REG),
+	regmap_reg_range(BMI270_FIFO_DATA_REG, BMI270_FIFO_DATA_REG),
+};
+
+const struct regmap_access_table bmi270_precious_table = {
+	.yes_ranges = bmi270_precious_ranges,
+	.n_yes_ranges = ARRAY_SIZE(bmi270_precious_ranges),
+};
+EXPORT_SYMBOL_GPL(bmi270_precious_table);
 
 struct bmi270_scale {
 	int scale;
@@ -337,20 +634,110 @@ static const struct  bmi270_odr_item bmi270_odr_table[] = {
 	},
 };
 
-enum bmi270_feature_reg_id {
-	/* Page 1 registers */
-	BMI270_ANYMO1_REG,
-	BMI270_ANYMO2_REG,
-	/* Page 2 registers */
-	BMI270_NOMO1_REG,
-	BMI270_NOMO2_REG,
-	/* Page 6 registers */
-	BMI270_SC_26_REG,
+/*
+ * 3dB cutoff in mHz of the normal (OSR 1) performance mode filter, starting
+ * at the lowest ODR performance mode supports. Oversampling by 2^n gives
+ * the cutoff of the normal filter n ODR steps lower.
+ */
+static const u32 bmi270_accel_3db_mhz[] = {
+	5060, 10120, 20250, 40500, 80000, 162000, 324000, 684000,
+};
+
+static const u32 bmi270_gyro_3db_mhz[] = {
+	10700, 20800, 39900, 74600, 136600, 254600, 523900, 890000,
+};
+
+/*
+ * filter_low_pass_3db_frequency_available for each ODR, from its first
+ * ODR code up: the cutoffs at OSR 4, 2 and 1, which is ascending order.
+ * These follow from the tables above.
+ */
+static const int bmi270_accel_3db_avail[][BMI270_PERF_OSR_NUM][2] = {
+	{ { 0, 79000 }, { 0, 158000 }, { 0, 316000 } },	/* 0.78Hz */
+	{ { 0, 158000 }, { 0, 316000 }, { 0, 632000 } },	/* 1.56Hz */
+	{ { 0, 316000 }, { 0, 632000 }, { 1, 265000 } },	/* 3.12Hz */
+	{ { 0, 632000 }, { 1, 265000 }, { 2, 530000 } },	/* 6.25Hz */
+	{ { 1, 265000 }, { 2, 530000 }, { 5, 60000 } },	/* 12.5Hz */
+	{ { 2, 530000 }, { 5, 60000 }, { 10, 120000 } },	/* 25Hz */
+	{ { 5, 60000 }, { 10, 120000 }, { 20, 250000 } },	/* 50Hz */
+	{ { 10, 120000 }, { 20, 250000 }, { 40, 500000 } },	/* 100Hz */
+	{ { 20, 250000 }, { 40, 500000 }, { 80, 0 } },	/* 200Hz */
+	{ { 40, 500000 }, { 80, 0 }, { 162, 0 } },	/* 400Hz */
+	{ { 80, 0 }, { 162, 0 }, { 324, 0 } },	/* 800Hz */
+	{ { 162, 0 }, { 324, 0 }, { 684, 0 } },	/* 1600Hz */
+};
+
+static const int bmi270_gyro_3db_avail[][BMI270_PERF_OSR_NUM][2] = {
+	{ { 2, 675000 }, { 5, 350000 }, { 10, 700000 } },	/* 25Hz */
+	{ { 5, 350000 }, { 10, 700000 }, { 20, 800000 } },	/* 50Hz */
+	{ { 10, 700000 }, { 20, 800000 }, { 39, 900000 } },	/* 100Hz */
+	{ { 20, 800000 }, { 39, 900000 }, { 74, 600000 } },	/* 200Hz */
+	{ { 39, 900000 }, { 74, 600000 }, { 136, 600000 } },	/* 400Hz */
+	{ { 74, 600000 }, { 136, 600000 }, { 254, 600000 } },	/* 800Hz */
+	{ { 136, 600000 }, { 254, 600000 }, { 523, 900000 } },	/* 1600Hz */
+	{ { 254, 600000 }, { 523, 900000 }, { 890, 0 } },	/* 3200Hz */
+};
+
+struct bmi270_filter_item {
+	const u32 *tbl;
+	u8 first_odr;
+	int num;
+	const int (*avail)[BMI270_PERF_OSR_NUM][2];
+	u8 avail_first_odr;
+	int avail_num;
+};
+
+static const struct bmi270_filter_item bmi270_filter_table[] = {
+	[BMI270_ACCEL] = {
+		.tbl		= bmi270_accel_3db_mhz,
+		.first_odr	= BMI270_ACC_CONF_ODR_12_5HZ,
+		.num		= ARRAY_SIZE(bmi270_accel_3db_mhz),
+		.avail		= bmi270_accel_3db_avail,
+		.avail_first_odr = BMI270_ACC_CONF_ODR_0_78HZ,
+		.avail_num	= ARRAY_SIZE(bmi270_accel_3db_avail),
+	},
+	[BMI270_GYRO] = {
+		.tbl		= bmi270_gyro_3db_mhz,
+		.first_odr	= BMI270_GYR_CONF_ODR_25HZ,
+		.num		= ARRAY_SIZE(bmi270_gyro_3db_mhz),
+		.avail		= bmi270_gyro_3db_avail,
+		.avail_first_odr = BMI270_GYR_CONF_ODR_25HZ,
+		.avail_num	= ARRAY_SIZE(bmi270_gyro_3db_avail),
+	},
+};
+
+static const int bmi270_perf_osr_avail[BMI270_PERF_OSR_NUM] = { 1, 2, 4 };
+
+static const int bmi270_accel_avg_avail[] = {
+	1, 2, 4, 8, 16, 32, 64, 128,
+};
+
+static const char * const bmi270_power_modes[] = {
+	[BMI270_LOW_POWER]	= "low_power",
+	[BMI270_PERFORMANCE]	= "performance",
 };
 
+static int bmi270_init_status(struct bmi270_data *data)
+{
+	return READ_ONCE(data->init_status);
+}
+
+static int bmi270_pm_get(struct bmi270_data *data)
+{
+	return pm_runtime_resume_and_get(data->dev);
+}
+
+static void bmi270_pm_put(struct bmi270_data *data)
+{
+	pm_runtime_mark_last_busy(data->dev);
+	pm_runtime_put_autosuspend(data->dev);
+}
+
 struct bmi270_feature_reg {
 	u8 page;
 	u8 addr;
+	/* Bits cleared by the device once the command they carry is done */
+	u16 self_clear;
 };
 
 static const struct bmi270_feature_reg bmi270_feature_regs[] = {
@@ -373,23 +760,31 @@ static const struct bmi270_feature_reg bmi270_feature_regs[] = {
 	[BMI270_SC_26_REG] = {
 		.page = 6,
 		.addr = 0x32,
+		.self_clear = BMI270_STEP_SC26_RST_CNT_MSK,
 	},
 };
 
-static int bmi270_write_feature_reg(struct bmi270_data *data,
-				    enum bmi270_feature_reg_id id,
-				    u16 val)
-{
-	const struct bmi270_feature_reg *reg = &bmi270_feature_regs[id];
-	int ret;
+/*
+ * Feature register updates staged by bmi270_feat_txn_update() and written
+ * out by bmi270_feat_txn_commit(), one bulk write per run of adjacent
+ * registers on a page.
+ */
+struct bmi270_feat_txn {
+	unsigned long staged;
+	u16 val[BMI270_NUM_FEATURE_REGS];
+};
 
-	ret = regmap_write(data->regmap, BMI270_FEAT_PAGE_REG, reg->page);
-	if (ret)
-		return ret;
+static void bmi270_feat_txn_begin(struct bmi270_feat_txn *txn)
+{
+	txn->staged = 0;
+}
 
-	data->regval = cpu_to_le16(val);
-	return regmap_bulk_write(data->regmap, reg->addr, &data->regval,
-				 sizeof(data->regval));
+static int bmi270_select_feature_page(struct bmi270_data *data, u8 page)
+{
+	/* FEAT_PAGE is cached, so this is free if the page is already set */
+	return regmap_update_bits(data->regmap, BMI270_FEAT_PAGE_REG,
+				  BMI270_FEAT_PAGE_MSK,
+				  FIELD_PREP(BMI270_FEAT_PAGE_MSK, page));
 }
 
 static int bmi270_read_feature_reg(struct bmi270_data *data,
@@ -399,16 +794,131 @@ static int bmi270_read_feature_reg(struct bmi270_data *data,
 	const struct bmi270_feature_reg *reg = &bmi270_feature_regs[id];
 	int ret;
 
-	ret = regmap_write(data->regmap, BMI270_FEAT_PAGE_REG, reg->page);
+	if (test_bit(id, &data->feat_cached)) {
+		*val = data->feat_cache[id];
+		return 0;
+	}
+
+	ret = bmi270_select_feature_page(data, reg->page);
+	if (ret)
+		return ret;
+
+	ret = regmap_bulk_read(data->regmap, reg->addr, &data->feat_buf[0],
+			       sizeof(data->feat_buf[0]));
 	if (ret)
 		return ret;
 
-	ret = regmap_bulk_read(data->regmap, reg->addr, &data->regval,
-			       sizeof(data->regval));
+	*val = le16_to_cpu(data->feat_buf[0]);
+	data->feat_cache[id] = *val;
+	__set_bit(id, &data->feat_cached);
+	return 0;
+}
+
+static int bmi270_feat_txn_update(struct bmi270_data *data,
+				  struct bmi270_feat_txn *txn,
+				  enum bmi270_feature_reg_id id,
+				  u16 mask, u16 val)
+{
+	u16 regval;
+	int ret;
+
+	if (test_bit(id, &txn->staged)) {
+		regval = txn->val[id];
+	} else {
+		ret = bmi270_read_feature_reg(data, id, &regval);
+		if (ret)
+			return ret;
+	}
+
+	txn->val[id] = (regval & ~mask) | (val & mask);
+	__set_bit(id, &txn->staged);
+	return 0;
+}
+
+static int bmi270_feat_txn_commit_page(struct bmi270_data *data,
+				       struct bmi270_feat_txn *txn, u8 page)
+{
+	const struct bmi270_feature_reg *reg;
+	unsigned long slots = 0;
+	unsigned int id, start, len;
+	int ret;
+
+	ret = bmi270_select_feature_page(data, page);
 	if (ret)
 		return ret;
 
-	*val = le16_to_cpu(data->regval);
+	for_each_set_bit(id, &txn->staged, BMI270_NUM_FEATURE_REGS) {
+		reg = &bmi270_feature_regs[id];
+		if (reg->page != page)
+			continue;
+
+		start = (reg->addr - BMI270_FEAT_DATA_START_REG) / 2;
+		data->feat_buf[start] = cpu_to_le16(txn->val[id]);
+		__set_bit(start, &slots);
+	}
+
+	while (slots) {
+		start = __ffs(slots);
+		len = ffz(slots >> start);
+		ret = regmap_bulk_write(data->regmap,
+					BMI270_FEAT_DATA_START_REG + 2 * start,
+					&data->feat_buf[start],
+					len * sizeof(data->feat_buf[0]));
+		if (ret)
+			return ret;
+
+		slots &= ~GENMASK(start + len - 1, start);
+	}
+
+	return 0;
+}
+
+static int bmi270_feat_txn_commit(struct bmi270_data *data,
+				  struct bmi270_feat_txn *txn)
+{
+	const struct bmi270_feature_reg *reg;
+	unsigned long pending = txn->staged;
+	unsigned int id;
+	int ret;
+
+	while (pending) {
+		u8 page = bmi270_feature_regs[__ffs(pending)].page;
+
+		ret = bmi270_feat_txn_commit_page(data, txn, page);
+		if (ret)
+			return ret;
+
+		for_each_set_bit(id, &txn->staged, BMI270_NUM_FEATURE_REGS) {
+			reg = &bmi270_feature_regs[id];
+			if (reg->page != page)
+				continue;
+
+			data->feat_cache[id] = txn->val[id] & ~reg->self_clear;
+			__set_bit(id, &data->feat_cached);
+			__clear_bit(id, &pending);
+		}
+	}
+
+	txn->staged = 0;
+	return 0;
+}
+
+/*
+ * Fill the feature shadow once, so that reading event configuration never
+ * needs the bus and works while the device is runtime suspended.
+ */
+static int bmi270_feat_cache_init(struct bmi270_data *data)
+{
+	unsigned int id;
+	u16 val;
+	int ret;
+
+	for (id = 0; id < BMI270_NUM_FEATURE_REGS; id++) {
+		ret = bmi270_read_feature_reg(data, id, &val);
+		if (ret)
+			return ret;
+	}
+
 	return 0;
 }
 
@@ -416,16 +926,122 @@ static int bmi270_update_feature_reg(struct bmi270_data *data,
 				     enum bmi270_feature_reg_id id,
 				     u16 mask, u16 val)
 {
-	u16 regval;
+	struct bmi270_feat_txn txn;
 	int ret;
 
-	ret = bmi270_read_feature_reg(data, id, &regval);
+	bmi270_feat_txn_begin(&txn);
+	ret = bmi270_feat_txn_update(data, &txn, id, mask, val);
 	if (ret)
 		return ret;
 
-	regval = (regval & ~mask) | (val & mask);
+	return bmi270_feat_txn_commit(data, &txn);
+}
+
+/* ODR code 8 is 100Hz, each step up or down doubles or halves the rate */
+static unsigned int bmi270_odr_period_us(unsigned int odr)
+{
+	if (odr >= 8)
+		return (10 * USEC_PER_MSEC) >> (odr - 8);
+
+	return (10 * USEC_PER_MSEC) << (8 - odr);
+}
+
+/*
+ * Wait until the sensor blocks in @blocks, just powered up, deliver their
+ * first valid sample. The gyroscope needs up to 45ms to start, and slow
+ * output data rates add up to two sample periods on top.
+ */
+static int bmi270_wait_data_ready(struct bmi270_data *data,
+				  unsigned long blocks)
+{
+	unsigned int conf, status, drdy = 0, period = 0;
+	int ret;
+
+	if (blocks & BMI270_PWR_CTRL_ACCEL_EN_MSK) {
+		ret = regmap_read(data->regmap, BMI270_ACC_CONF_REG, &conf);
+		if (ret)
+			return ret;
+
+		drdy |= BMI270_STATUS_DRDY_ACC_MSK;
+		conf = FIELD_GET(BMI270_ACC_CONF_ODR_MSK, conf);
+		period = max(period, bmi270_odr_period_us(conf));
+	}
+
+	if (blocks & BMI270_PWR_CTRL_GYR_EN_MSK) {
+		ret = regmap_read(data->regmap, BMI270_GYR_CONF_REG, &conf);
+		if (ret)
+			return ret;
+
+		drdy |= BMI270_STATUS_DRDY_GYR_MSK;
+		conf = FIELD_GET(BMI270_GYR_CONF_ODR_MSK, conf);
+		period = max(period, bmi270_odr_period_us(conf));
+	}
+
+	if (drdy) {
+		ret = regmap_read_poll_timeout(data->regmap, BMI270_STATUS_REG,
+					       status, (status & drdy) == drdy,
+					       BMI270_WAKE_POLL_US,
+					       BMI270_WAKE_TIMEOUT_US + 2 * period);
+		if (ret)
+			return ret;
+	}
+
+	if (blocks & BMI270_PWR_CTRL_TEMP_EN_MSK)
+		return regmap_read_poll_timeout(data->regmap,
+						BMI270_TEMPERATURE_1_REG, status,
+						status != BMI270_TEMPERATURE_INVALID_MSB,
+						BMI270_WAKE_POLL_US,
+						BMI270_WAKE_TIMEOUT_US);
+
+	return 0;
+}
+
+/*
+ * Take a reference on each PWR_CTRL sensor block in @blocks, powering up
+ * the ones that were off. Returns once their first sample is valid.
+ */
+static int bmi270_power_get(struct bmi270_data *data, unsigned long blocks)
+{
+	unsigned long on = 0;
+	unsigned int bit;
+	int ret;
+
+	lockdep_assert_held(&data->mutex);
+
+	for_each_set_bit(bit, &blocks, BMI270_PWR_CTRL_BLOCKS)
+		if (!data->pwr_refs[bit]++)
+			on |= BIT(bit);
+
+	if (!on)
+		return 0;
+
+	ret = regmap_set_bits(data->regmap, BMI270_PWR_CTRL_REG, on);
+	if (!ret)
+		ret = bmi270_wait_data_ready(data, on);
+	if (ret) {
+		for_each_set_bit(bit, &blocks, BMI270_PWR_CTRL_BLOCKS)
+			data->pwr_refs[bit]--;
+		regmap_clear_bits(data->regmap, BMI270_PWR_CTRL_REG, on);
+	}
+
+	return ret;
+}
+
+static int bmi270_power_put(struct bmi270_data *data, unsigned long blocks)
+{
+	unsigned long off = 0;
+	unsigned int bit;
+
+	lockdep_assert_held(&data->mutex);
+
+	for_each_set_bit(bit, &blocks, BMI270_PWR_CTRL_BLOCKS)
+		if (!--data->pwr_refs[bit])
+			off |= BIT(bit);
+
+	if (!off)
+		return 0;
 
-	return bmi270_write_feature_reg(data, id, regval);
+	return regmap_clear_bits(data->regmap, BMI270_PWR_CTRL_REG, off);
 }
 
 static int bmi270_enable_steps(struct bmi270_data *data, int val)
@@ -433,17 +1049,30 @@ static int bmi270_enable_steps(struct bmi270_data *data, int val)
 	int ret;
 
 	guard(mutex)(&data->mutex);
-	if (data->steps_enabled)
+	if (data->steps_enabled == !!val)
 		return 0;
 
+	/* The step counter runs on accelerometer data */
+	if (val) {
+		ret = bmi270_power_get(data, BMI270_PWR_CTRL_ACCEL_EN_MSK);
+		if (ret)
+			return ret;
+	}
+
 	ret = bmi270_update_feature_reg(data, BMI270_SC_26_REG,
 					BMI270_STEP_SC26_EN_CNT_MSK,
 					FIELD_PREP(BMI270_STEP_SC26_EN_CNT_MSK,
 						   val ? 1 : 0));
-	if (ret)
+	if (ret) {
+		if (val)
+			bmi270_power_put(data, BMI270_PWR_CTRL_ACCEL_EN_MSK);
 		return ret;
+	}
 
-	data->steps_enabled = true;
+	if (!val)
+		bmi270_power_put(data, BMI270_PWR_CTRL_ACCEL_EN_MSK);
+
+	data->steps_enabled = val;
 	return 0;
 }
 
@@ -481,7 +1110,7 @@ static int bmi270_step_wtrmrk_en(struct bmi270_data *data, bool state)
 	if (!data->steps_enabled)
 		return -EINVAL;
 
-	reg = bmi270_int_map_reg(data->irq_pin);
+	reg = bmi270_int_map_reg(data->feat_pin);
 	if (reg < 0)
 		return reg;
 
@@ -522,10 +1151,11 @@ static int bmi270_anymotion_event_en(struct bmi270_data *data,
 				     bool state)
 {
 	u16 axis_msk, axis_field_val, regval;
+	struct bmi270_feat_txn txn;
 	int ret, irq_reg;
 	bool axis_en;
 
-	irq_reg = bmi270_int_map_reg(data->irq_pin);
+	irq_reg = bmi270_int_map_reg(data->feat_pin);
 	if (irq_reg < 0)
 		return irq_reg;
 
@@ -558,15 +1188,20 @@ static int bmi270_anymotion_event_en(struct bmi270_data *data,
 		return -EINVAL;
 	}
 
-	ret = bmi270_update_feature_reg(data, BMI270_ANYMO1_REG, axis_msk,
-					axis_field_val);
+	bmi270_feat_txn_begin(&txn);
+	ret = bmi270_feat_txn_update(data, &txn, BMI270_ANYMO1_REG, axis_msk,
+				     axis_field_val);
+	if (ret)
+		return ret;
+
+	ret = bmi270_feat_txn_update(data, &txn, BMI270_ANYMO2_REG,
+				     BMI270_FEAT_MOTION_ENABLE_MSK,
+				     FIELD_PREP(BMI270_FEAT_MOTION_ENABLE_MSK,
+						state || axis_en));
 	if (ret)
 		return ret;
 
-	ret = bmi270_update_feature_reg(data, BMI270_ANYMO2_REG,
-					BMI270_FEAT_MOTION_ENABLE_MSK,
-					FIELD_PREP(BMI270_FEAT_MOTION_ENABLE_MSK,
-						   state || axis_en));
+	ret = bmi270_feat_txn_commit(data, &txn);
 	if (ret)
 		return ret;
 
@@ -578,25 +1213,31 @@ static int bmi270_anymotion_event_en(struct bmi270_data *data,
 
 static int bmi270_nomotion_event_en(struct bmi270_data *data, bool state)
 {
+	struct bmi270_feat_txn txn;
 	int ret, irq_reg;
 
-	irq_reg = bmi270_int_map_reg(data->irq_pin);
+	irq_reg = bmi270_int_map_reg(data->feat_pin);
 	if (irq_reg < 0)
 		return irq_reg;
 
 	guard(mutex)(&data->mutex);
 
-	ret = bmi270_update_feature_reg(data, BMI270_NOMO1_REG,
-					BMI270_FEAT_MOTION_XYZ_EN_MSK,
-					FIELD_PREP(BMI270_FEAT_MOTION_XYZ_EN_MSK,
-						   state ? BMI270_MOTION_XYZ_MSK : 0));
+	bmi270_feat_txn_begin(&txn);
+	ret = bmi270_feat_txn_update(data, &txn, BMI270_NOMO1_REG,
+				     BMI270_FEAT_MOTION_XYZ_EN_MSK,
+				     FIELD_PREP(BMI270_FEAT_MOTION_XYZ_EN_MSK,
+						state ? BMI270_MOTION_XYZ_MSK : 0));
+	if (ret)
+		return ret;
+
+	ret = bmi270_feat_txn_update(data, &txn, BMI270_NOMO2_REG,
+				     BMI270_FEAT_MOTION_ENABLE_MSK,
+				     FIELD_PREP(BMI270_FEAT_MOTION_ENABLE_MSK,
+						state));
 	if (ret)
 		return ret;
 
-	ret = bmi270_update_feature_reg(data, BMI270_NOMO2_REG,
-					BMI270_FEAT_MOTION_ENABLE_MSK,
-					FIELD_PREP(BMI270_FEAT_MOTION_ENABLE_MSK,
-						   state));
+	ret = bmi270_feat_txn_commit(data, &txn);
 	if (ret)
 		return ret;
 
@@ -682,8 +1323,9 @@ static int bmi270_get_scale(struct bmi270_data *data, int chan_type, int *scale,
 static int bmi270_set_odr(struct bmi270_data *data, int chan_type, int odr,
 			  int uodr)
 {
-	int i;
+	int i, ret;
 	int reg, mask;
+	unsigned int conf;
 	struct bmi270_odr_item bmi270_odr_item;
 
 	switch (chan_type) {
@@ -703,11 +1345,21 @@ static int bmi270_set_odr(struct bmi270_data *data, int chan_type, int odr,
 
 	guard(mutex)(&data->mutex);
 
+	ret = regmap_read(data->regmap, reg, &conf);
+	if (ret)
+		return ret;
+
 	for (i = 0; i < bmi270_odr_item.num; i++) {
 		if (bmi270_odr_item.tbl[i].odr != odr ||
 		    bmi270_odr_item.tbl[i].uodr != uodr)
 			continue;
 
+		/* The accelerometer filter needs at least 12.5Hz */
+		if (chan_type == IIO_ACCEL &&
+		    conf & BMI270_ACC_CONF_FILTER_PERF_MSK &&
+		    bmi270_odr_item.vals[i] < BMI270_ACC_CONF_ODR_12_5HZ)
+			return -EINVAL;
+
 		return regmap_update_bits(data->regmap, reg, mask,
 					  bmi270_odr_item.vals[i]);
 	}
@@ -721,8 +1373,7 @@ static int bmi270_get_odr(struct bmi270_data *data, int chan_type, int *odr,
 	int i, val, ret;
 	struct bmi270_odr_item bmi270_odr_item;
 
-	guard(mutex)(&data->mutex);
-
+	/* A single cached register read, no need to serialise */
 	switch (chan_type) {
 	case IIO_ACCEL:
 		ret = regmap_read(data->regmap, BMI270_ACC_CONF_REG, &val);
@@ -756,29 +1407,1055 @@ static int bmi270_get_odr(struct bmi270_data *data, int chan_type, int *odr,
 	return -EINVAL;
 }
 
-static irqreturn_t bmi270_irq_thread_handler(int irq, void *private)
+struct bmi270_filter {
+	enum bmi270_power_mode mode;
+	u8 bwp;
+	u8 odr;
+};
+
+/* All of it lives in the cached ACC_CONF and GYR_CONF registers */
+static int bmi270_get_filter(struct bmi270_data *data, int chan_type,
+			     struct bmi270_filter *f)
+{
+	unsigned int val;
+	int ret;
+
+	switch (chan_type) {
+	case IIO_ACCEL:
+		ret = regmap_read(data->regmap, BMI270_ACC_CONF_REG, &val);
+		if (ret)
+			return ret;
+
+		f->mode = FIELD_GET(BMI270_ACC_CONF_FILTER_PERF_MSK, val);
+		f->bwp = FIELD_GET(BMI270_ACC_CONF_BWP_MSK, val);
+		f->odr = FIELD_GET(BMI270_ACC_CONF_ODR_MSK, val);
+		return 0;
+	case IIO_ANGL_VEL:
+		ret = regmap_read(data->regmap, BMI270_GYR_CONF_REG, &val);
+		if (ret)
+			return ret;
+
+		f->mode = FIELD_GET(BMI270_GYR_CONF_FILTER_PERF_MSK, val);
+		f->bwp = FIELD_GET(BMI270_GYR_CONF_BWP_MSK, val);
+		f->odr = FIELD_GET(BMI270_GYR_CONF_ODR_MSK, val);
+		return 0;
+	default:
+		return -EINVAL;
+	}
+}
+
+static int bmi270_set_filter(struct bmi270_data *data, int chan_type,
+			     const struct bmi270_filter *f)
+{
+	bool perf = f->mode == BMI270_PERFORMANCE;
+
+	switch (chan_type) {
+	case IIO_ACCEL:
+		return regmap_update_bits(data->regmap, BMI270_ACC_CONF_REG,
+					  BMI270_ACC_CONF_FILTER_PERF_MSK |
+					  BMI270_ACC_CONF_BWP_MSK,
+					  FIELD_PREP(BMI270_ACC_CONF_FILTER_PERF_MSK, perf) |
+					  FIELD_PREP(BMI270_ACC_CONF_BWP_MSK, f->bwp));
+	case IIO_ANGL_VEL:
+		/* Noise and filter performance are switched together */
+		return regmap_update_bits(data->regmap, BMI270_GYR_CONF_REG,
+					  BMI270_GYR_CONF_FILTER_PERF_MSK |
+					  BMI270_GYR_CONF_NOISE_PERF_MSK |
+					  BMI270_GYR_CONF_BWP_MSK,
+					  FIELD_PREP(BMI270_GYR_CONF_FILTER_PERF_MSK, perf) |
+					  FIELD_PREP(BMI270_GYR_CONF_NOISE_PERF_MSK, perf) |
+					  FIELD_PREP(BMI270_GYR_CONF_BWP_MSK, f->bwp));
+	default:
+		return -EINVAL;
+	}
+}
+
+/*
+ * The accelerometer averages 2^BWP samples in low power mode. Otherwise
+ * BWP selects OSR4, OSR2 or the normal filter, in that order.
+ */
+static bool bmi270_filter_averages(int chan_type, const struct bmi270_filter *f)
+{
+	return chan_type == IIO_ACCEL && f->mode == BMI270_LOW_POWER;
+}
+
+static int bmi270_filter_osr(int chan_type, const struct bmi270_filter *f)
+{
+	if (bmi270_filter_averages(chan_type, f))
+		return BIT(f->bwp);
+
+	if (f->bwp > BMI270_ACC_CONF_BWP_NORMAL_MODE)
+		return -EINVAL;
+
+	return BIT(BMI270_ACC_CONF_BWP_NORMAL_MODE - f->bwp);
+}
+
+static int bmi270_filter_bwp(int chan_type, const struct bmi270_filter *f,
+			     int osr)
+{
+	if (osr < 1 || !is_power_of_2(osr))
+		return -EINVAL;
+
+	if (bmi270_filter_averages(chan_type, f))
+		return osr > BIT(BMI270_ACC_CONF_BWP_AVG_MAX) ? -EINVAL : ilog2(osr);
+
+	return osr > 4 ? -EINVAL : BMI270_ACC_CONF_BWP_NORMAL_MODE - ilog2(osr);
+}
+
+/* Only the performance mode filter has a documented cutoff */
+static int bmi270_filter_3db_mhz(int chan_type, const struct bmi270_filter *f,
+				 int osr)
+{
+	const struct bmi270_filter_item *item;
+	int odr;
+
+	if (bmi270_filter_averages(chan_type, f))
+		return -EINVAL;
+
+	item = &bmi270_filter_table[chan_type == IIO_ACCEL ? BMI270_ACCEL :
+							     BMI270_GYRO];
+	odr = f->odr - ilog2(osr) - item->first_odr;
+	if (odr < 0)
+		return item->tbl[0] >> -odr;
+
+	return item->tbl[min(odr, item->num - 1)];
+}
+
+static int bmi270_get_filter_3db(struct bmi270_data *data, int chan_type,
+				 int *val, int *val2)
+{
+	struct bmi270_filter f;
+	int ret, osr;
+
+	ret = bmi270_get_filter(data, chan_type, &f);
+	if (ret)
+		return ret;
+
+	osr = bmi270_filter_osr(chan_type, &f);
+	if (osr < 0)
+		return osr;
+
+	ret = bmi270_filter_3db_mhz(chan_type, &f, osr);
+	if (ret < 0)
+		return ret;
+
+	*val = ret / 1000;
+	*val2 = (ret % 1000) * 1000;
+	return IIO_VAL_INT_PLUS_MICRO;
+}
+
+static int bmi270_set_osr(struct bmi270_data *data, int chan_type, int osr)
+{
+	struct bmi270_filter f;
+	int ret;
+
+	guard(mutex)(&data->mutex);
+
+	ret = bmi270_get_filter(data, chan_type, &f);
+	if (ret)
+		return ret;
+
+	ret = bmi270_filter_bwp(chan_type, &f, osr);
+	if (ret < 0)
+		return ret;
+
+	f.bwp = ret;
+	return bmi270_set_filter(data, chan_type, &f);
+}
+
+/* Pick the oversampling ratio whose cutoff is the one asked for */
+static int bmi270_set_filter_3db(struct bmi270_data *data, int chan_type,
+				 int val, int val2)
+{
+	struct bmi270_filter f;
+	int ret, i;
+
+	guard(mutex)(&data->mutex);
+
+	ret = bmi270_get_filter(data, chan_type, &f);
+	if (ret)
+		return ret;
+
+	for (i = 0; i < ARRAY_SIZE(bmi270_perf_osr_avail); i++) {
+		ret = bmi270_filter_3db_mhz(chan_type, &f,
+					    bmi270_perf_osr_avail[i]);
+		if (ret < 0)
+			return ret;
+
+		if (ret / 1000 != val || (ret % 1000) * 1000 != val2)
+			continue;
+
+		f.bwp = bmi270_filter_bwp(chan_type, &f,
+					  bmi270_perf_osr_avail[i]);
+		return bmi270_set_filter(data, chan_type, &f);
+	}
+
+	return -EINVAL;
+}
+
+/* The cutoff list for the current ODR, in ascending order */
+static int bmi270_filter_3db_avail(struct bmi270_data *data, int chan_type,
+				   const int **vals, int *length)
+{
+	const struct bmi270_filter_item *item;
+	struct bmi270_filter f;
+	int ret, i;
+
+	ret = bmi270_get_filter(data, chan_type, &f);
+	if (ret)
+		return ret;
+
+	if (bmi270_filter_averages(chan_type, &f))
+		return -EINVAL;
+
+	item = &bmi270_filter_table[chan_type == IIO_ACCEL ? BMI270_ACCEL :
+							     BMI270_GYRO];
+	i = f.odr - item->avail_first_odr;
+	if (i < 0 || i >= item->avail_num)
+		return -EINVAL;
+
+	*vals = (const int *)item->avail[i];
+	*length = BMI270_PERF_OSR_NUM * 2;
+	return IIO_AVAIL_LIST;
+}
+
+static int bmi270_get_power_mode(struct iio_dev *indio_dev,
+				 const struct iio_chan_spec *chan)
 {
-	struct iio_dev *indio_dev = private;
 	struct bmi270_data *data = iio_priv(indio_dev);
-	unsigned int status0, status1;
-	s64 timestamp = iio_get_time_ns(indio_dev);
+	struct bmi270_filter f;
 	int ret;
 
-	scoped_guard(mutex, &data->mutex) {
-		ret = regmap_read(data->regmap, BMI270_INT_STATUS_0_REG,
-				  &status0);
+	ret = bmi270_get_filter(data, chan->type, &f);
+	if (ret)
+		return ret;
+
+	return f.mode;
+}
+
+/*
+ * Switch between the power optimized and the performance filters, keeping
+ * the oversampling ratio where the new mode supports it.
+ */
+static int __bmi270_set_power_mode(struct bmi270_data *data, int chan_type,
+				   enum bmi270_power_mode mode)
+{
+	struct bmi270_filter f;
+	int ret, osr;
+
+	guard(mutex)(&data->mutex);
+
+	ret = bmi270_get_filter(data, chan_type, &f);
+	if (ret)
+		return ret;
+
+	osr = bmi270_filter_osr(chan_type, &f);
+	if (osr < 0)
+		osr = 1;
+
+	if (mode == BMI270_PERFORMANCE && chan_type == IIO_ACCEL &&
+	    f.odr < BMI270_ACC_CONF_ODR_12_5HZ)
+		return -EINVAL;
+
+	f.mode = mode;
+	f.bwp = bmi270_filter_bwp(chan_type, &f, min(osr, 4));
+	return bmi270_set_filter(data, chan_type, &f);
+}
+
+static int bmi270_set_power_mode(struct iio_dev *indio_dev,
+				 const struct iio_chan_spec *chan,
+				 unsigned int mode)
+{
+	struct bmi270_data *data = iio_priv(indio_dev);
+	int ret;
+
+	ret = bmi270_init_status(data);
+	if (ret)
+		return ret;
+
+	ret = iio_device_claim_direct_mode(indio_dev);
+	if (ret)
+		return ret;
+
+	ret = bmi270_pm_get(data);
+	if (!ret) {
+		ret = __bmi270_set_power_mode(data, chan->type, mode);
+		bmi270_pm_put(data);
+	}
+	iio_device_release_direct_mode(indio_dev);
+	return ret;
+}
+
+static const struct iio_enum bmi270_power_mode_enum = {
+	.items = bmi270_power_modes,
+	.num_items = ARRAY_SIZE(bmi270_power_modes),
+	.get = bmi270_get_power_mode,
+	.set = bmi270_set_power_mode,
+};
+
+/*
+ * Sample period in sensortime ticks of the sensors bmi270_scan_setup()
+ * enabled. Temperature and step count alone follow the accelerometer.
+ */
+static int bmi270_frame_ticks(struct bmi270_data *data)
+{
+	int odr, uodr, ret;
+	u64 fastest = 0;
+
+	if (data->fifo_sensors & BMI270_FIFO_CONFIG_1_GYR_EN_MSK) {
+		ret = bmi270_get_odr(data, IIO_ANGL_VEL, &odr, &uodr);
 		if (ret)
-			return IRQ_NONE;
+			return ret;
 
-		ret = regmap_read(data->regmap, BMI270_INT_STATUS_1_REG,
-				  &status1);
+		fastest = (u64)odr * MICRO + uodr;
+	}
+
+	if (data->fifo_sensors & BMI270_FIFO_CONFIG_1_ACC_EN_MSK ||
+	    !data->fifo_sensors) {
+		ret = bmi270_get_odr(data, IIO_ACCEL, &odr, &uodr);
 		if (ret)
-			return IRQ_NONE;
+			return ret;
+
+		fastest = max(fastest, (u64)odr * MICRO + uodr);
+	}
+
+	/* Every supported ODR divides the sensortime rate by a power of two */
+	data->frame_ticks = DIV_ROUND_CLOSEST_ULL((u64)BMI270_SENSORTIME_HZ * MICRO,
+						  fastest);
+	return 0;
+}
+
+static s64 bmi270_sensortime_unwrap(struct bmi270_sensortime *st, u32 raw)
+{
+	st->ticks += (raw - st->raw) & BMI270_SENSORTIME_MSK;
+	st->raw = raw;
+
+	return st->ticks;
+}
+
+static s64 bmi270_sensortime_to_ns(struct bmi270_sensortime *st, s64 ticks)
+{
+	return st->anchor_ns +
+	       div_s64((ticks - st->anchor_ticks) * st->tick_ps, 1000);
+}
+
+/*
+ * Feed the model with a sample taken at @ticks whose interrupt was seen at
+ * @ns. The interrupt timestamp trails the sample by the IRQ latency, so only
+ * a fraction of each prediction error is applied to the offset and to the
+ * rate, which averages the scheduling jitter out.
+ */
+static void bmi270_sensortime_update(struct bmi270_sensortime *st, s64 ticks,
+				     s64 ns)
+{
+	s64 dticks = ticks - st->anchor_ticks;
+	s64 pred, err;
+
+	pred = bmi270_sensortime_to_ns(st, ticks);
+	err = ns - pred;
+
+	if (!st->valid || abs(err) > BMI270_SENSORTIME_RESYNC_NS) {
+		st->anchor_ticks = ticks;
+		st->anchor_ns = ns;
+		st->valid = true;
+		return;
+	}
+
+	if (dticks <= 0)
+		return;
+
+	st->tick_ps += div_s64(err * 1000, dticks * BMI270_SENSORTIME_FREQ_GAIN);
+	st->tick_ps = clamp_t(s64, st->tick_ps,
+			      BMI270_SENSORTIME_TICK_PS - BMI270_SENSORTIME_MAX_DRIFT_PS,
+			      BMI270_SENSORTIME_TICK_PS + BMI270_SENSORTIME_MAX_DRIFT_PS);
+
+	st->anchor_ticks = ticks;
+	st->anchor_ns = pred + div_s64(err, BMI270_SENSORTIME_PHASE_GAIN);
+}
+
+/* Timestamp for the sample taken at @ticks, never going backwards */
+static s64 bmi270_sensortime_stamp(struct bmi270_sensortime *st, s64 ticks)
+{
+	s64 ns = bmi270_sensortime_to_ns(st, ticks);
+
+	if (ns <= st->last_ns)
+		ns = st->last_ns + 1;
+
+	st->last_ns = ns;
+	return ns;
+}
+
+/* Offset from CLOCK_BOOTTIME to the clock selected for the IIO device */
+static s64 bmi270_clock_offset(struct iio_dev *indio_dev)
+{
+	if (iio_device_get_clock(indio_dev) == CLOCK_BOOTTIME)
+		return 0;
+
+	return iio_get_time_ns(indio_dev) - ktime_get_boottime_ns();
+}
+
+static void bmi270_push_sample(struct iio_dev *indio_dev, s64 ticks,
+			       s64 offset)
+{
+	struct bmi270_data *data = iio_priv(indio_dev);
+	s64 ns = bmi270_sensortime_stamp(&data->sensortime, ticks);
+	unsigned int i;
+
+	for (i = 0; i < data->scan_len; i++)
+		data->buffer.channels[i] = data->samples[data->scan_src[i]];
+
+	iio_push_to_buffers_with_timestamp(indio_dev, &data->buffer,
+					   ns + offset);
+}
+
+/* Pre-build the data burst read for the transport fast path, if any */
+static int bmi270_stream_prepare(struct bmi270_data *data)
+{
+	struct bmi270_transport *tr = data->transport;
+
+	lockdep_assert_held(&data->data_lock);
+
+	if (!tr)
+		return 0;
+
+	return tr->ops->stream_prepare(tr, BMI270_ACCEL_X_REG +
+				       2 * data->burst_first, data->burst_len);
+}
+
+/* Read the register window set up by bmi270_scan_setup() */
+static int bmi270_stream_read(struct bmi270_data *data)
+{
+	struct bmi270_transport *tr = data->transport;
+
+	if (tr)
+		return tr->ops->stream_read(tr, data->burst);
+
+	return regmap_bulk_read(data->regmap,
+				BMI270_ACCEL_X_REG + 2 * data->burst_first,
+				data->burst, data->burst_len);
+}
+
+static unsigned int bmi270_fifo_read_limit(struct bmi270_data *data)
+{
+	size_t max = data->transport ? data->transport->fifo_read_max :
+				       regmap_get_raw_read_max(data->regmap);
+
+	if (!max || max > BMI270_FIFO_READ_MAX)
+		return BMI270_FIFO_READ_MAX;
+
+	return max;
+}
+
+static int bmi270_fifo_read(struct bmi270_data *data, unsigned int len)
+{
+	struct bmi270_transport *tr = data->transport;
+
+	if (tr)
+		return tr->ops->fifo_read(tr, BMI270_FIFO_DATA_REG,
+					  data->fifo_buf, len);
+
+	return regmap_noinc_read(data->regmap, BMI270_FIFO_DATA_REG,
+				 data->fifo_buf, len);
+}
+
+/*
+ * Temperature and step count are neither part of the data burst nor of
+ * FIFO frames. They sit close together behind the status registers, so
+ * whenever one of them is due the other one is refreshed in the same
+ * transaction if it is enabled as well. @force ignores the decimation.
+ */
+static int bmi270_read_slow_channels(struct bmi270_data *data, bool force)
+{
+	bool temp_due = data->temp_en && (force || !data->temp_count);
+	bool steps_due = data->steps_en && (force || !data->steps_count);
+	unsigned int reg, len;
+	int ret;
+
+	if (data->temp_count)
+		data->temp_count--;
+	if (data->steps_count)
+		data->steps_count--;
+
+	if (!temp_due && !steps_due)
+		return 0;
+
+	if (data->temp_en && data->steps_en) {
+		temp_due = steps_due = true;
+		reg = BMI270_SC_OUT_0_REG;
+		len = BMI270_SLOW_BURST_LEN;
+	} else if (temp_due) {
+		reg = BMI270_TEMPERATURE_0_REG;
+		len = sizeof(__le16);
+	} else {
+		reg = BMI270_SC_OUT_0_REG;
+		len = sizeof(__le16);
+	}
+
+	ret = regmap_bulk_read(data->regmap, reg, data->slow_burst, len);
+	if (ret)
+		return ret;
+
+	if (steps_due) {
+		memcpy(&data->samples[BMI270_SCAN_STEPS], data->slow_burst,
+		       sizeof(__le16));
+		data->steps_count = data->steps_decim - 1;
+	}
+
+	if (temp_due) {
+		memcpy(&data->samples[BMI270_SCAN_TEMP],
+		       &data->slow_burst[len - sizeof(__le16)], sizeof(__le16));
+		data->temp_count = data->temp_decim - 1;
+	}
+
+	return 0;
+}
+
+/*
+ * Return the payload length of the FIFO frame introduced by @header, or a
+ * negative error code once the end of the valid FIFO data has been reached.
+ */
+static int bmi270_fifo_frame_len(u8 header)
+{
+	int len = 0;
+
+	switch (FIELD_GET(BMI270_FIFO_HEADER_MODE_MSK, header)) {
+	case BMI270_FIFO_HEADER_MODE_DATA:
+		if (header & BMI270_FIFO_HEADER_AUX_MSK)
+			len += BMI270_FIFO_AUX_LEN;
+		if (header & BMI270_FIFO_HEADER_GYR_MSK)
+			len += BMI270_FIFO_ACC_GYR_LEN;
+		if (header & BMI270_FIFO_HEADER_ACC_MSK)
+			len += BMI270_FIFO_ACC_GYR_LEN;
+
+		/* A data header without any sensor flags marks an over-read */
+		return len ?: -ENODATA;
+	case BMI270_FIFO_HEADER_MODE_CTRL:
+		switch (FIELD_GET(BMI270_FIFO_HEADER_PARM_MSK, header)) {
+		case BMI270_FIFO_HEADER_PARM_SKIP:
+			return BMI270_FIFO_SKIP_LEN;
+		case BMI270_FIFO_HEADER_PARM_SENSORTIME:
+			return BMI270_FIFO_SENSORTIME_LEN;
+		case BMI270_FIFO_HEADER_PARM_INPUT_CFG:
+			return BMI270_FIFO_INPUT_CFG_LEN;
+		default:
+			return -EINVAL;
+		}
+	default:
+		return -EINVAL;
+	}
+}
+
+static bool bmi270_fifo_is_data(u8 header)
+{
+	return FIELD_GET(BMI270_FIFO_HEADER_MODE_MSK, header) ==
+	       BMI270_FIFO_HEADER_MODE_DATA;
+}
+
+/*
+ * Step over the next complete frame of a FIFO dump. On success the frame
+ * header is stored in @header and the offset of its payload is returned.
+ * A frame truncated by the end of the dump is left for the next read, the
+ * device retransmits partially read frames.
+ */
+static int bmi270_fifo_next_frame(const u8 *fifo, unsigned int len,
+				  unsigned int *pos, u8 *header)
+{
+	unsigned int payload;
+	int frame_len;
+
+	if (*pos >= len)
+		return -ENODATA;
+
+	*header = fifo[*pos];
+	frame_len = bmi270_fifo_frame_len(*header);
+	if (frame_len < 0)
+		return frame_len;
+
+	payload = *pos + 1;
+	if (payload + frame_len > len)
+		return -ENODATA;
+
+	*pos = payload + frame_len;
+	return payload;
+}
+
+/*
+ * Data frames only carry the sensors that produced a sample, so the
+ * channels of a sensor missing from a frame keep their previous value.
+ */
+static void bmi270_fifo_unpack(struct bmi270_data *data, const u8 *payload,
+			       u8 header)
+{
+	if (header & BMI270_FIFO_HEADER_AUX_MSK)
+		payload += BMI270_FIFO_AUX_LEN;
+
+	if (header & BMI270_FIFO_HEADER_GYR_MSK) {
+		memcpy(&data->samples[BMI270_SCAN_GYRO_X], payload,
+		       BMI270_FIFO_ACC_GYR_LEN);
+		payload += BMI270_FIFO_ACC_GYR_LEN;
+	}
+
+	if (header & BMI270_FIFO_HEADER_ACC_MSK)
+		memcpy(&data->samples[BMI270_SCAN_ACCEL_X], payload,
+		       BMI270_FIFO_ACC_GYR_LEN);
+}
+
+/*
+ * Drain up to @samples frames in one bus transaction. The device resends a
+ * frame that was read only in part, so a read split into several
+ * transactions would see it twice; a frame cut off at the end of the read
+ * is left for the next drain.
+ */
+static int bmi270_fifo_drain(struct iio_dev *indio_dev, unsigned int samples,
+			     bool irq)
+{
+	struct bmi270_data *data = iio_priv(indio_dev);
+	unsigned int len, pos, count;
+	s64 ticks, offset;
+	bool drained = false;
+	__le16 fifo_len;
+	u8 header;
+	int ret;
+
+	ret = regmap_bulk_read(data->regmap, BMI270_FIFO_LENGTH_0_REG,
+			       &fifo_len, sizeof(fifo_len));
+	if (ret)
+		return ret;
+
+	samples = min_t(unsigned int, samples, BMI270_FIFO_SIZE);
+	len = FIELD_GET(BMI270_FIFO_LENGTH_MSK, le16_to_cpu(fifo_len));
+	len = min_t(unsigned int, len, samples * data->fifo_frame_len);
+	len = min_t(unsigned int, len, data->fifo_read_max - 1 -
+					BMI270_FIFO_SENSORTIME_LEN);
+	if (!len)
+		return 0;
+
+	/* Reading past the last frame returns the sensortime frame */
+	len += 1 + BMI270_FIFO_SENSORTIME_LEN;
+
+	ret = bmi270_fifo_read(data, len);
+	if (ret)
+		return ret;
+
+	count = 0;
+	pos = 0;
+	ticks = data->fifo_next_ticks;
+	while ((ret = bmi270_fifo_next_frame(data->fifo_buf, len, &pos,
+					     &header)) >= 0) {
+		if (bmi270_fifo_is_data(header)) {
+			count++;
+			continue;
+		}
+
+		switch (FIELD_GET(BMI270_FIFO_HEADER_PARM_MSK, header)) {
+		case BMI270_FIFO_HEADER_PARM_SKIP:
+			/* Frames dropped on overflow still took their slot */
+			count += data->fifo_buf[ret];
+			break;
+		case BMI270_FIFO_HEADER_PARM_SENSORTIME:
+			ticks = bmi270_sensortime_unwrap(&data->sensortime,
+							 get_unaligned_le24(&data->fifo_buf[ret]));
+			drained = true;
+			break;
+		}
+	}
+
+	if (!count)
+		return 0;
+
+	/*
+	 * The sensortime frame reports the time of the read, which falls in
+	 * the slot of the last data frame. Without it the batch continues
+	 * right where the previous one stopped.
+	 */
+	if (drained)
+		ticks = round_down(ticks, data->frame_ticks) -
+			(s64)(count - 1) * data->frame_ticks;
+
+	/*
+	 * The watermark interrupt fires as the watermark-th frame lands in an
+	 * empty FIFO, which pairs that frame with the hard IRQ timestamp.
+	 */
+	if (irq && data->fifo_drained && count >= data->watermark)
+		bmi270_sensortime_update(&data->sensortime,
+					 ticks + (s64)(data->watermark - 1) *
+						 data->frame_ticks,
+					 data->irq_tstamp);
+
+	data->fifo_drained = drained;
+	data->fifo_next_ticks = ticks + (s64)count * data->frame_ticks;
+	offset = bmi270_clock_offset(indio_dev);
+
+	/* One drain covers many samples, always refresh the slow channels */
+	ret = bmi270_read_slow_channels(data, true);
+	if (ret)
+		return ret;
+
+	pos = 0;
+	while ((ret = bmi270_fifo_next_frame(data->fifo_buf, len, &pos,
+					     &header)) >= 0) {
+		if (!bmi270_fifo_is_data(header)) {
+			if (FIELD_GET(BMI270_FIFO_HEADER_PARM_MSK, header) ==
+			    BMI270_FIFO_HEADER_PARM_SKIP)
+				ticks += (s64)data->fifo_buf[ret] *
+					 data->frame_ticks;
+			continue;
+		}
+
+		bmi270_fifo_unpack(data, &data->fifo_buf[ret], header);
+		bmi270_push_sample(indio_dev, ticks, offset);
+		ticks += data->frame_ticks;
 	}
 
+	return count;
+}
+
+/* Drain until the FIFO is empty or @samples frames have been pushed */
+static int bmi270_fifo_flush(struct iio_dev *indio_dev, unsigned int samples,
+			     bool irq)
+{
+	struct bmi270_data *data = iio_priv(indio_dev);
+	unsigned int total = 0;
+	int ret;
+
+	do {
+		/* Only the first drain can pair a frame with the IRQ */
+		ret = bmi270_fifo_drain(indio_dev, samples - total,
+					irq && !total);
+		if (ret <= 0)
+			break;
+
+		total += ret;
+	} while (!data->fifo_drained && total < samples);
+
+	return total ?: ret;
+}
+
+static int bmi270_fifo_int_mask(enum bmi270_irq_pin pin)
+{
+	switch (pin) {
+	case BMI270_IRQ_INT1:
+		return BMI270_INT_MAP_DATA_FWM_INT1_MSK |
+		       BMI270_INT_MAP_DATA_FFULL_INT1_MSK;
+	case BMI270_IRQ_INT2:
+		return BMI270_INT_MAP_DATA_FWM_INT2_MSK |
+		       BMI270_INT_MAP_DATA_FFULL_INT2_MSK;
+	default:
+		return -EINVAL;
+	}
+}
+
+static int bmi270_fifo_enable(struct iio_dev *indio_dev)
+{
+	struct bmi270_data *data = iio_priv(indio_dev);
+	__le16 watermark;
+	int ret, int_msk;
+
+	int_msk = bmi270_fifo_int_mask(data->irq_pin);
+	if (int_msk < 0)
+		return int_msk;
+
+	ret = regmap_write(data->regmap, BMI270_FIFO_CONFIG_0_REG,
+			   BMI270_FIFO_CONFIG_0_TIME_EN_MSK);
+	if (ret)
+		return ret;
+
+	ret = regmap_write(data->regmap, BMI270_FIFO_CONFIG_1_REG,
+			   BMI270_FIFO_CONFIG_1_HEADER_EN_MSK |
+			   data->fifo_sensors);
+	if (ret)
+		return ret;
+
+	/* The watermark register counts bytes, not frames */
+	watermark = cpu_to_le16(FIELD_PREP(BMI270_FIFO_WTM_MSK,
+					   data->watermark *
+					   data->fifo_frame_len));
+	ret = regmap_bulk_write(data->regmap, BMI270_FIFO_WTM_0_REG,
+				&watermark, sizeof(watermark));
+	if (ret)
+		return ret;
+
+	ret = regmap_write(data->regmap, BMI270_CMD_REG,
+			   BMI270_CMD_FIFO_FLUSH);
+	if (ret)
+		return ret;
+
+	/* The first frame lands in the sensortime slot after the flush */
+	ret = regmap_bulk_read(data->regmap, BMI270_SENSORTIME_0_REG,
+			       data->burst, 3);
+	if (ret)
+		return ret;
+
+	data->fifo_next_ticks = bmi270_sensortime_unwrap(&data->sensortime,
+							 get_unaligned_le24(data->burst));
+	bmi270_sensortime_update(&data->sensortime, data->fifo_next_ticks,
+				 ktime_get_boottime_ns());
+	data->fifo_next_ticks = round_down(data->fifo_next_ticks,
+					   data->frame_ticks) +
+				data->frame_ticks;
+	data->fifo_drained = true;
+
+	ret = regmap_set_bits(data->regmap, BMI270_INT_MAP_DATA_REG, int_msk);
+	if (ret)
+		return ret;
+
+	data->fifo_mode = true;
+	return 0;
+}
+
+static int bmi270_fifo_disable(struct bmi270_data *data)
+{
+	int ret, int_msk;
+
+	int_msk = bmi270_fifo_int_mask(data->irq_pin);
+	if (int_msk < 0)
+		return int_msk;
+
+	data->fifo_mode = false;
+
+	ret = regmap_clear_bits(data->regmap, BMI270_INT_MAP_DATA_REG, int_msk);
+	if (ret)
+		return ret;
+
+	return regmap_write(data->regmap, BMI270_FIFO_CONFIG_1_REG, 0);
+}
+
+/*
+ * Work out once per buffer enable which samples make up the scan and the
+ * smallest register window holding them. The window always runs up to the
+ * end of SENSORTIME, which times the sample.
+ */
+static void bmi270_scan_setup(struct bmi270_data *data,
+			      const unsigned long *mask)
+{
+	unsigned int i;
+
+	data->scan_len = 0;
+	for_each_set_bit(i, mask, BMI270_SCAN_TIMESTAMP)
+		data->scan_src[data->scan_len++] = i;
+
+	data->burst_first = find_first_bit(mask, BMI270_SCAN_TEMP);
+	data->burst_len = BMI270_DATA_BURST_LEN - 2 * data->burst_first;
+	data->temp_en = test_bit(BMI270_SCAN_TEMP, mask);
+	data->steps_en = test_bit(BMI270_SCAN_STEPS, mask);
+	data->temp_count = 0;
+	data->steps_count = 0;
+
+	data->fifo_sensors = 0;
+	data->fifo_frame_len = 1;
+	if (*mask & BMI270_SCAN_ACCEL_MSK) {
+		data->fifo_sensors |= BMI270_FIFO_CONFIG_1_ACC_EN_MSK;
+		data->fifo_frame_len += BMI270_FIFO_ACC_GYR_LEN;
+	}
+	if (*mask & BMI270_SCAN_GYRO_MSK) {
+		data->fifo_sensors |= BMI270_FIFO_CONFIG_1_GYR_EN_MSK;
+		data->fifo_frame_len += BMI270_FIFO_ACC_GYR_LEN;
+	}
+}
+
+/* Sensor blocks feeding the channels in @mask */
+static unsigned long bmi270_scan_blocks(const unsigned long *mask)
+{
+	unsigned long blocks = 0;
+
+	if (*mask & (BMI270_SCAN_ACCEL_MSK | BIT(BMI270_SCAN_STEPS)))
+		blocks |= BMI270_PWR_CTRL_ACCEL_EN_MSK;
+	if (*mask & BMI270_SCAN_GYRO_MSK)
+		blocks |= BMI270_PWR_CTRL_GYR_EN_MSK;
+	if (*mask & BIT(BMI270_SCAN_TEMP))
+		blocks |= BMI270_PWR_CTRL_TEMP_EN_MSK;
+
+	return blocks;
+}
+
+static int bmi270_buffer_preenable(struct iio_dev *indio_dev)
+{
+	struct bmi270_data *data = iio_priv(indio_dev);
+	int ret;
+
+	ret = bmi270_init_status(data);
+	if (ret)
+		return ret;
+
+	/* Released in postdisable */
+	ret = bmi270_pm_get(data);
+	if (ret)
+		return ret;
+
+	guard(mutex)(&data->mutex);
+
+	data->buffer_blocks = bmi270_scan_blocks(indio_dev->active_scan_mask);
+	ret = bmi270_power_get(data, data->buffer_blocks);
+	if (ret) {
+		bmi270_pm_put(data);
+		return ret;
+	}
+
+	scoped_guard(mutex, &data->data_lock) {
+		bmi270_scan_setup(data, indio_dev->active_scan_mask);
+
+		/*
+		 * Keep the learnt rate but re-anchor the model on the next
+		 * sample
+		 */
+		data->sensortime.valid = false;
+
+		ret = bmi270_frame_ticks(data);
+		if (!ret)
+			ret = bmi270_stream_prepare(data);
+	}
+	if (ret) {
+		bmi270_power_put(data, data->buffer_blocks);
+		bmi270_pm_put(data);
+	}
+
+	return ret;
+}
+
+static int bmi270_buffer_postenable(struct iio_dev *indio_dev)
+{
+	struct bmi270_data *data = iio_priv(indio_dev);
+
+	/* The hardware FIFO is only used when no trigger is attached */
+	if (iio_device_get_current_mode(indio_dev) == INDIO_BUFFER_TRIGGERED)
+		return 0;
+
+	/* Temperature alone produces no FIFO frames */
+	if (!data->fifo_sensors)
+		return -EINVAL;
+
+	guard(mutex)(&data->mutex);
+	guard(mutex)(&data->data_lock);
+
+	return bmi270_fifo_enable(indio_dev);
+}
+
+static int bmi270_buffer_predisable(struct iio_dev *indio_dev)
+{
+	struct bmi270_data *data = iio_priv(indio_dev);
+
+	if (iio_device_get_current_mode(indio_dev) == INDIO_BUFFER_TRIGGERED)
+		return 0;
+
+	guard(mutex)(&data->mutex);
+	guard(mutex)(&data->data_lock);
+
+	/* Hand the frames still queued in the FIFO over to userspace */
+	bmi270_fifo_flush(indio_dev, BMI270_FIFO_SIZE, false);
+
+	return bmi270_fifo_disable(data);
+}
+
+static int bmi270_buffer_postdisable(struct iio_dev *indio_dev)
+{
+	struct bmi270_data *data = iio_priv(indio_dev);
+
+	scoped_guard(mutex, &data->mutex)
+		bmi270_power_put(data, data->buffer_blocks);
+
+	bmi270_pm_put(data);
+	return 0;
+}
+
+static const struct iio_buffer_setup_ops bmi270_buffer_ops = {
+	.preenable = bmi270_buffer_preenable,
+	.postenable = bmi270_buffer_postenable,
+	.predisable = bmi270_buffer_predisable,
+	.postdisable = bmi270_buffer_postdisable,
+};
+
+static int bmi270_set_watermark(struct iio_dev *indio_dev, unsigned int val)
+{
+	struct bmi270_data *data = iio_priv(indio_dev);
+
+	guard(mutex)(&data->data_lock);
+
+	data->watermark = clamp_t(unsigned int, val, 1,
+				  BMI270_FIFO_WATERMARK_MAX);
+	return 0;
+}
+
+static int bmi270_flush_to_buffer(struct iio_dev *indio_dev,
+				  unsigned int count)
+{
+	struct bmi270_data *data = iio_priv(indio_dev);
+
+	guard(mutex)(&data->data_lock);
+
+	if (!data->fifo_mode)
+		return 0;
+
+	return bmi270_fifo_flush(indio_dev, count, false);
+}
+
+static ssize_t hwfifo_watermark_show(struct device *dev,
+				     struct device_attribute *attr, char *buf)
+{
+	struct iio_dev *indio_dev = dev_to_iio_dev(dev);
+	struct bmi270_data *data = iio_priv(indio_dev);
+
+	guard(mutex)(&data->data_lock);
+
+	return sysfs_emit(buf, "%u\n", data->watermark);
+}
+
+static ssize_t hwfifo_enabled_show(struct device *dev,
+				   struct device_attribute *attr, char *buf)
+{
+	struct iio_dev *indio_dev = dev_to_iio_dev(dev);
+	struct bmi270_data *data = iio_priv(indio_dev);
+
+	guard(mutex)(&data->data_lock);
+
+	return sysfs_emit(buf, "%d\n", data->fifo_mode);
+}
+
+IIO_STATIC_CONST_DEVICE_ATTR(hwfifo_watermark_min, "1");
+IIO_STATIC_CONST_DEVICE_ATTR(hwfifo_watermark_max,
+			     __stringify(BMI270_FIFO_WATERMARK_MAX));
+static IIO_DEVICE_ATTR_RO(hwfifo_watermark, 0);
+static IIO_DEVICE_ATTR_RO(hwfifo_enabled, 0);
+
+static const struct iio_dev_attr *bmi270_fifo_attributes[] = {
+	&iio_dev_attr_hwfifo_watermark_min,
+	&iio_dev_attr_hwfifo_watermark_max,
+	&iio_dev_attr_hwfifo_watermark,
+	&iio_dev_attr_hwfifo_enabled,
+	NULL
+};
+
+static irqreturn_t bmi270_irq_handler(int irq, void *private)
+{
+	struct iio_dev *indio_dev = private;
+	struct bmi270_data *data = iio_priv(indio_dev);
+
+	data->irq_tstamp = ktime_get_boottime_ns();
+	return IRQ_WAKE_THREAD;
+}
+
+static void bmi270_handle_data_status(struct iio_dev *indio_dev,
+				      unsigned int status1)
+{
+	struct bmi270_data *data = iio_priv(indio_dev);
+
 	if (FIELD_GET(BMI270_INT_STATUS_1_ACC_GYR_DRDY_MSK, status1))
 		iio_trigger_poll_nested(data->trig);
 
+	if (status1 & (BMI270_INT_STATUS_1_FWM_MSK |
+		       BMI270_INT_STATUS_1_FFULL_MSK)) {
+		scoped_guard(mutex, &data->data_lock) {
+			if (data->fifo_mode)
+				bmi270_fifo_flush(indio_dev, BMI270_FIFO_SIZE,
+						  true);
+		}
+	}
+}
+
+static void bmi270_handle_feat_status(struct iio_dev *indio_dev,
+				      unsigned int status0)
+{
+	s64 timestamp = iio_get_time_ns(indio_dev);
+
 	if (FIELD_GET(BMI270_INT_STATUS_0_MOTION_MSK, status0))
 		iio_push_event(indio_dev, IIO_MOD_EVENT_CODE(IIO_ACCEL, 0,
 							     IIO_MOD_X_OR_Y_OR_Z,
@@ -798,6 +2475,67 @@ static irqreturn_t bmi270_irq_thread_handler(int irq, void *private)
 							       IIO_EV_TYPE_CHANGE,
 							       IIO_EV_DIR_NONE),
 			       timestamp);
+}
+
+/* Single pin: both status registers are read in one burst */
+static irqreturn_t bmi270_irq_thread_handler(int irq, void *private)
+{
+	struct iio_dev *indio_dev = private;
+	struct bmi270_data *data = iio_priv(indio_dev);
+	int ret;
+
+	ret = regmap_bulk_read(data->regmap, BMI270_INT_STATUS_0_REG,
+			       data->int_status, sizeof(data->int_status));
+	if (ret)
+		return IRQ_NONE;
+
+	bmi270_handle_data_status(indio_dev, data->int_status[1]);
+	bmi270_handle_feat_status(indio_dev, data->int_status[0]);
+
+	return IRQ_HANDLED;
+}
+
+/*
+ * Dedicated data pin. It carries either data ready or the FIFO interrupts,
+ * never both, so unless the interrupt is latched and has to be cleared the
+ * source is known without touching the bus.
+ */
+static irqreturn_t bmi270_data_irq_thread_handler(int irq, void *private)
+{
+	struct iio_dev *indio_dev = private;
+	struct bmi270_data *data = iio_priv(indio_dev);
+	unsigned int status1;
+	int ret;
+
+	if (data->int_latch) {
+		ret = regmap_read(data->regmap, BMI270_INT_STATUS_1_REG,
+				  &status1);
+		if (ret)
+			return IRQ_NONE;
+	} else if (READ_ONCE(data->fifo_mode)) {
+		status1 = BMI270_INT_STATUS_1_FWM_MSK;
+	} else {
+		status1 = BMI270_INT_STATUS_1_ACC_GYR_DRDY_MSK;
+	}
+
+	bmi270_handle_data_status(indio_dev, status1);
+
+	return IRQ_HANDLED;
+}
+
+/* Dedicated feature pin */
+static irqreturn_t bmi270_feat_irq_thread_handler(int irq, void *private)
+{
+	struct iio_dev *indio_dev = private;
+	struct bmi270_data *data = iio_priv(indio_dev);
+	unsigned int status0;
+	int ret;
+
+	ret = regmap_read(data->regmap, BMI270_INT_STATUS_0_REG, &status0);
+	if (ret)
+		return IRQ_NONE;
+
+	bmi270_handle_feat_status(indio_dev, status0);
 
 	return IRQ_HANDLED;
 }
@@ -832,37 +2570,121 @@ static int bmi270_data_rdy_trigger_set_state(struct iio_trigger *trig,
 				  field_value);
 }
 
-static const struct iio_trigger_ops bmi270_trigger_ops = {
-	.set_trigger_state = &bmi270_data_rdy_trigger_set_state,
-};
-
+static const struct iio_trigger_ops bmi270_trigger_ops = {
+	.set_trigger_state = &bmi270_data_rdy_trigger_set_state,
+};
+
+/*
+ * The streaming data path: one data burst, pushed with the sample time.
+ * It only takes data_lock, so configuration holding data->mutex or
+ * reading the regmap cache never stalls it.
+ */
+static int bmi270_read_sample(struct iio_dev *indio_dev, s64 tstamp)
+{
+	struct bmi270_data *data = iio_priv(indio_dev);
+	s64 ticks;
+	int ret;
+
+	guard(mutex)(&data->data_lock);
+
+	ret = bmi270_stream_read(data);
+	if (ret)
+		return ret;
+
+	memcpy(&data->samples[data->burst_first], data->burst,
+	       data->burst_len - BMI270_SENSORTIME_LEN);
+
+	ret = bmi270_read_slow_channels(data, false);
+	if (ret)
+		return ret;
+
+	/* The sample was taken on the last ODR boundary before the read */
+	ticks = get_unaligned_le24(&data->burst[data->burst_len -
+						BMI270_SENSORTIME_LEN]);
+	ticks = bmi270_sensortime_unwrap(&data->sensortime, ticks);
+	ticks = round_down(ticks, data->frame_ticks);
+
+	bmi270_sensortime_update(&data->sensortime, ticks, tstamp);
+	bmi270_push_sample(indio_dev, ticks, bmi270_clock_offset(indio_dev));
+
+	return 0;
+}
+
 static irqreturn_t bmi270_trigger_handler(int irq, void *p)
 {
     struct iio_poll_func *pf = p;
     struct iio_dev *indio_dev = pf->indio_dev;
     struct bmi270_data *data = iio_priv(indio_dev);
-    int ret;
+    s64 tstamp;
 
-    guard(mutex)(&data->mutex);
+    /* Our own trigger polls nested, so pf->timestamp is never set */
+    if (indio_dev->trig == data->trig)
+        tstamp = data->irq_tstamp;
+    else
+        tstamp = pf->timestamp - bmi270_clock_offset(indio_dev);
 
-    ret = regmap_bulk_read(data->regmap, BMI270_ACCEL_X_REG,
-                           data->buffer.channels,
-                           sizeof(data->buffer.channels));
-    if (ret)
-        goto done;
+    bmi270_read_sample(indio_dev, tstamp);
 
-    data->buffer.timestamp = cpu_to_le64(iio_get_time_ns(indio_dev));
-
-    iio_push_to_buffers(indio_dev, &data->buffer);
-
-done:
     iio_trigger_notify_done(indio_dev->trig);
     return IRQ_HANDLED;
 }
 
+static void bmi270_raw_work(struct work_struct *work)
+{
+	struct bmi270_data *data = container_of(work, struct bmi270_data,
+						raw_work.work);
+	unsigned long blocks;
+
+	scoped_guard(mutex, &data->mutex) {
+		blocks = data->raw_blocks;
+		data->raw_blocks = 0;
+		if (blocks)
+			bmi270_power_put(data, blocks);
+	}
+
+	if (blocks)
+		bmi270_pm_put(data);
+}
+
+/*
+ * Raw reads keep their sensor block, and the device, up for the
+ * autosuspend delay after the last read instead of paying the start-up
+ * time on every read.
+ */
+static int bmi270_raw_power_get(struct bmi270_data *data, unsigned long block)
+{
+	int ret;
+
+	lockdep_assert_held(&data->mutex);
+
+	if (!(data->raw_blocks & block)) {
+		ret = bmi270_power_get(data, block);
+		if (ret)
+			return ret;
+
+		/* Dropped by bmi270_raw_work() */
+		if (!data->raw_blocks)
+			pm_runtime_get_noresume(data->dev);
+		data->raw_blocks |= block;
+	}
+
+	mod_delayed_work(system_wq, &data->raw_work,
+			 msecs_to_jiffies(BMI270_AUTOSUSPEND_DELAY_MS));
+	return 0;
+}
+
+/* Release what raw reads still hold rather than leak it on unbind */
+static void bmi270_release_raw(void *context)
+{
+	struct bmi270_data *data = context;
+
+	flush_delayed_work(&data->raw_work);
+}
+
 static int bmi270_get_data(struct bmi270_data *data, int chan_type, int axis,
 			   int *val)
 {
+	unsigned long block;
 	__le16 sample;
 	int reg;
 	int ret;
@@ -870,12 +2692,15 @@ static int bmi270_get_data(struct bmi270_data *data, int chan_type, int axis,
 	switch (chan_type) {
 	case IIO_ACCEL:
 		reg = BMI270_ACCEL_X_REG + (axis - IIO_MOD_X) * 2;
+		block = BMI270_PWR_CTRL_ACCEL_EN_MSK;
 		break;
 	case IIO_ANGL_VEL:
 		reg = BMI270_ANG_VEL_X_REG + (axis - IIO_MOD_X) * 2;
+		block = BMI270_PWR_CTRL_GYR_EN_MSK;
 		break;
 	case IIO_TEMP:
 		reg = BMI270_TEMPERATURE_0_REG;
+		block = BMI270_PWR_CTRL_TEMP_EN_MSK;
 		break;
 	default:
 		return -EINVAL;
@@ -883,6 +2708,10 @@ static int bmi270_get_data(struct bmi270_data *data, int chan_type, int axis,
 
 	guard(mutex)(&data->mutex);
 
+	ret = bmi270_raw_power_get(data, block);
+	if (ret)
+		return ret;
+
 	ret = regmap_bulk_read(data->regmap, reg, &sample, sizeof(sample));
 	if (ret)
 		return ret;
@@ -892,6 +2721,224 @@ static int bmi270_get_data(struct bmi270_data *data, int chan_type, int axis,
 	return IIO_VAL_INT;
 }
 
+static int bmi270_get_calibbias(struct bmi270_data *data, int chan_type,
+				int axis, int *val)
+{
+	unsigned int lsb, msb;
+	int i = axis - IIO_MOD_X;
+	int ret;
+
+	switch (chan_type) {
+	case IIO_ACCEL:
+		ret = regmap_read(data->regmap, BMI270_ACC_OFFSET_X_REG + i,
+				  &lsb);
+		if (ret)
+			return ret;
+
+		*val = sign_extend32(lsb, BMI270_ACC_OFFSET_BITS - 1);
+		return IIO_VAL_INT;
+	case IIO_ANGL_VEL:
+		ret = regmap_read(data->regmap, BMI270_GYR_OFFSET_X_REG + i,
+				  &lsb);
+		if (ret)
+			return ret;
+
+		ret = regmap_read(data->regmap, BMI270_OFFSET_6_REG, &msb);
+		if (ret)
+			return ret;
+
+		msb = (msb >> (2 * i)) & BMI270_OFFSET_6_GYR_MSB_MSK;
+		*val = sign_extend32(msb << 8 | lsb, BMI270_GYR_OFFSET_BITS - 1);
+		return IIO_VAL_INT;
+	default:
+		return -EINVAL;
+	}
+}
+
+static int bmi270_set_calibbias(struct bmi270_data *data, int chan_type,
+				int axis, int val)
+{
+	int i = axis - IIO_MOD_X;
+	int ret;
+
+	lockdep_assert_held(&data->mutex);
+
+	switch (chan_type) {
+	case IIO_ACCEL:
+		if (val < BMI270_ACC_OFFSET_MIN || val > BMI270_ACC_OFFSET_MAX)
+			return -EINVAL;
+
+		return regmap_write(data->regmap, BMI270_ACC_OFFSET_X_REG + i,
+				    val & 0xff);
+	case IIO_ANGL_VEL:
+		if (val < BMI270_GYR_OFFSET_MIN || val > BMI270_GYR_OFFSET_MAX)
+			return -EINVAL;
+
+		ret = regmap_write(data->regmap, BMI270_GYR_OFFSET_X_REG + i,
+				   val & 0xff);
+		if (ret)
+			return ret;
+
+		return regmap_update_bits(data->regmap, BMI270_OFFSET_6_REG,
+					  BMI270_OFFSET_6_GYR_MSB_MSK << (2 * i),
+					  ((val >> 8) & BMI270_OFFSET_6_GYR_MSB_MSK)
+					  << (2 * i));
+	default:
+		return -EINVAL;
+	}
+}
+
+static const int bmi270_accel_calibbias_range[] = {
+	BMI270_ACC_OFFSET_MIN, 1, BMI270_ACC_OFFSET_MAX,
+};
+
+static const int bmi270_gyro_calibbias_range[] = {
+	BMI270_GYR_OFFSET_MIN, 1, BMI270_GYR_OFFSET_MAX,
+};
+
+/*
+ * Host driven fast offset compensation. With compensation off, average
+ * BMI270_FOC_SAMPLES fresh samples and store their negated deviation from
+ * the expected reading as the offsets: zero rate for the gyroscope, and
+ * +1g on Z for the accelerometer, which must lie flat and face up.
+ */
+static int bmi270_foc(struct bmi270_data *data, int chan_type)
+{
+	unsigned int conf, range, reg, en_reg, en_msk, drdy, status, i, n;
+	unsigned long block;
+	int sum[3] = { }, target[3] = { }, off;
+	int ret, ret2;
+
+	switch (chan_type) {
+	case IIO_ACCEL:
+		block = BMI270_PWR_CTRL_ACCEL_EN_MSK;
+		drdy = BMI270_STATUS_DRDY_ACC_MSK;
+		reg = BMI270_ACCEL_X_REG;
+		en_reg = BMI270_NV_CONF_REG;
+		en_msk = BMI270_NV_CONF_ACC_OFF_EN_MSK;
+		ret = regmap_read(data->regmap, BMI270_ACC_CONF_REG, &conf);
+		if (ret)
+			return ret;
+		conf = FIELD_GET(BMI270_ACC_CONF_ODR_MSK, conf);
+		ret = regmap_read(data->regmap, BMI270_ACC_CONF_RANGE_REG, &range);
+		if (ret)
+			return ret;
+		range = FIELD_GET(BMI270_ACC_CONF_RANGE_MSK, range);
+		/* 16384 LSB/g at +-2g, halving with every range step */
+		target[2] = 16384 >> range;
+		break;
+	case IIO_ANGL_VEL:
+		block = BMI270_PWR_CTRL_GYR_EN_MSK;
+		drdy = BMI270_STATUS_DRDY_GYR_MSK;
+		reg = BMI270_ANG_VEL_X_REG;
+		en_reg = BMI270_OFFSET_6_REG;
+		en_msk = BMI270_OFFSET_6_GYR_OFF_EN_MSK;
+		ret = regmap_read(data->regmap, BMI270_GYR_CONF_REG, &conf);
+		if (ret)
+			return ret;
+		conf = FIELD_GET(BMI270_GYR_CONF_ODR_MSK, conf);
+		ret = regmap_read(data->regmap, BMI270_GYR_CONF_RANGE_REG, &range);
+		if (ret)
+			return ret;
+		range = FIELD_GET(BMI270_GYR_CONF_RANGE_MSK, range);
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	guard(mutex)(&data->mutex);
+
+	ret = bmi270_power_get(data, block);
+	if (ret)
+		return ret;
+
+	ret = regmap_clear_bits(data->regmap, en_reg, en_msk);
+	if (ret)
+		goto out_put;
+
+	/* The first sample may still have been compensated, drop it */
+	for (n = 0; n <= BMI270_FOC_SAMPLES; n++) {
+		ret = regmap_read_poll_timeout(data->regmap, BMI270_STATUS_REG,
+					       status, status & drdy,
+					       BMI270_WAKE_POLL_US,
+					       BMI270_WAKE_TIMEOUT_US +
+					       2 * bmi270_odr_period_us(conf));
+		if (ret)
+			goto out_enable;
+
+		ret = regmap_bulk_read(data->regmap, reg, data->foc_sample,
+				       sizeof(data->foc_sample));
+		if (ret)
+			goto out_enable;
+
+		for (i = 0; n && i < ARRAY_SIZE(sum); i++)
+			sum[i] += (s16)le16_to_cpu(data->foc_sample[i]);
+	}
+
+	for (i = 0; i < ARRAY_SIZE(sum); i++) {
+		sum[i] -= target[i] * BMI270_FOC_SAMPLES;
+		if (chan_type == IIO_ACCEL) {
+			/* Offset LSBs are 1/256g */
+			off = -DIV_ROUND_CLOSEST(sum[i] * 256,
+						 target[2] * BMI270_FOC_SAMPLES);
+			off = clamp(off, BMI270_ACC_OFFSET_MIN,
+				    BMI270_ACC_OFFSET_MAX);
+		} else {
+			/* Offset LSBs match the data LSBs at +-2000dps */
+			off = -DIV_ROUND_CLOSEST(sum[i],
+						 BMI270_FOC_SAMPLES << range);
+			off = clamp(off, BMI270_GYR_OFFSET_MIN,
+				    BMI270_GYR_OFFSET_MAX);
+		}
+
+		ret = bmi270_set_calibbias(data, chan_type, IIO_MOD_X + i, off);
+		if (ret)
+			break;
+	}
+
+out_enable:
+	ret2 = regmap_set_bits(data->regmap, en_reg, en_msk);
+	if (!ret)
+		ret = ret2;
+out_put:
+	bmi270_power_put(data, block);
+	return ret;
+}
+
+static ssize_t bmi270_calibrate_store(struct iio_dev *indio_dev,
+				      uintptr_t private,
+				      const struct iio_chan_spec *chan,
+				      const char *buf, size_t len)
+{
+	struct bmi270_data *data = iio_priv(indio_dev);
+	bool calibrate;
+	int ret;
+
+	ret = kstrtobool(buf, &calibrate);
+	if (ret)
+		return ret;
+
+	if (!calibrate)
+		return len;
+
+	ret = bmi270_init_status(data);
+	if (ret)
+		return ret;
+
+	ret = iio_device_claim_direct_mode(indio_dev);
+	if (ret)
+		return ret;
+
+	ret = bmi270_pm_get(data);
+	if (!ret) {
+		ret = bmi270_foc(data, chan->type);
+		bmi270_pm_put(data);
+	}
+	iio_device_release_direct_mode(indio_dev);
+
+	return ret ? ret : len;
+}
+
 static int bmi270_read_raw(struct iio_dev *indio_dev,
 			   struct iio_chan_spec const *chan,
 			   int *val, int *val2, long mask)
@@ -899,14 +2946,28 @@ static int bmi270_read_raw(struct iio_dev *indio_dev,
 	int ret;
 	struct bmi270_data *data = iio_priv(indio_dev);
 
+	ret = bmi270_init_status(data);
+	if (ret)
+		return ret;
+
 	switch (mask) {
 	case IIO_CHAN_INFO_PROCESSED:
-		return bmi270_read_steps(data, val);
+		ret = bmi270_pm_get(data);
+		if (ret)
+			return ret;
+		ret = bmi270_read_steps(data, val);
+		bmi270_pm_put(data);
+		return ret;
 	case IIO_CHAN_INFO_RAW:
 		ret = iio_device_claim_direct_mode(indio_dev);
 		if (ret)
 			return ret;
-		ret = bmi270_get_data(data, chan->type, chan->channel2, val);
+		ret = bmi270_pm_get(data);
+		if (!ret) {
+			ret = bmi270_get_data(data, chan->type, chan->channel2,
+					      val);
+			bmi270_pm_put(data);
+		}
 		iio_device_release_direct_mode(indio_dev);
 		return ret;
 	case IIO_CHAN_INFO_SCALE:
@@ -923,6 +2984,25 @@ static int bmi270_read_raw(struct iio_dev *indio_dev,
 	case IIO_CHAN_INFO_SAMP_FREQ:
 		ret = bmi270_get_odr(data, chan->type, val, val2);
 		return ret ? ret : IIO_VAL_INT_PLUS_MICRO;
+	case IIO_CHAN_INFO_OVERSAMPLING_RATIO: {
+		struct bmi270_filter f;
+
+		ret = bmi270_get_filter(data, chan->type, &f);
+		if (ret)
+			return ret;
+
+		ret = bmi270_filter_osr(chan->type, &f);
+		if (ret < 0)
+			return ret;
+
+		*val = ret;
+		return IIO_VAL_INT;
+	}
+	case IIO_CHAN_INFO_LOW_PASS_FILTER_3DB_FREQUENCY:
+		return bmi270_get_filter_3db(data, chan->type, val, val2);
+	case IIO_CHAN_INFO_CALIBBIAS:
+		return bmi270_get_calibbias(data, chan->type, chan->channel2,
+					    val);
 	case IIO_CHAN_INFO_ENABLE:
 		*val = data->steps_enabled ? 1 : 0;
 		return IIO_VAL_INT;
@@ -931,9 +3011,9 @@ static int bmi270_read_raw(struct iio_dev *indio_dev,
 	}
 }
 
-static int bmi270_write_raw(struct iio_dev *indio_dev,
-			    struct iio_chan_spec const *chan,
-			    int val, int val2, long mask)
+static int __bmi270_write_raw(struct iio_dev *indio_dev,
+			      struct iio_chan_spec const *chan,
+			      int val, int val2, long mask)
 {
 	struct bmi270_data *data = iio_priv(indio_dev);
 	int ret;
@@ -953,6 +3033,25 @@ static int bmi270_write_raw(struct iio_dev *indio_dev,
 		ret = bmi270_set_odr(data, chan->type, val, val2);
 		iio_device_release_direct_mode(indio_dev);
 		return ret;
+	case IIO_CHAN_INFO_OVERSAMPLING_RATIO:
+		ret = iio_device_claim_direct_mode(indio_dev);
+		if (ret)
+			return ret;
+		ret = bmi270_set_osr(data, chan->type, val);
+		iio_device_release_direct_mode(indio_dev);
+		return ret;
+	case IIO_CHAN_INFO_LOW_PASS_FILTER_3DB_FREQUENCY:
+		ret = iio_device_claim_direct_mode(indio_dev);
+		if (ret)
+			return ret;
+		ret = bmi270_set_filter_3db(data, chan->type, val, val2);
+		iio_device_release_direct_mode(indio_dev);
+		return ret;
+	case IIO_CHAN_INFO_CALIBBIAS: {
+		guard(mutex)(&data->mutex);
+		return bmi270_set_calibbias(data, chan->type, chan->channel2,
+					    val);
+	}
 	case IIO_CHAN_INFO_ENABLE:
 		return bmi270_enable_steps(data, val);
 	case IIO_CHAN_INFO_PROCESSED: {
@@ -971,11 +3070,35 @@ static int bmi270_write_raw(struct iio_dev *indio_dev,
 	}
 }
 
+static int bmi270_write_raw(struct iio_dev *indio_dev,
+			    struct iio_chan_spec const *chan,
+			    int val, int val2, long mask)
+{
+	struct bmi270_data *data = iio_priv(indio_dev);
+	int ret;
+
+	ret = bmi270_init_status(data);
+	if (ret)
+		return ret;
+
+	ret = bmi270_pm_get(data);
+	if (ret)
+		return ret;
+
+	ret = __bmi270_write_raw(indio_dev, chan, val, val2, mask);
+	bmi270_pm_put(data);
+	return ret;
+}
+
 static int bmi270_read_avail(struct iio_dev *indio_dev,
 			     struct iio_chan_spec const *chan,
 			     const int **vals, int *type, int *length,
 			     long mask)
 {
+	struct bmi270_data *data = iio_priv(indio_dev);
+	struct bmi270_filter f;
+	int ret;
+
 	switch (mask) {
 	case IIO_CHAN_INFO_SCALE:
 		*type = IIO_VAL_INT_PLUS_MICRO;
@@ -1005,6 +3128,37 @@ static int bmi270_read_avail(struct iio_dev *indio_dev,
 		default:
 			return -EINVAL;
 		}
+	case IIO_CHAN_INFO_OVERSAMPLING_RATIO:
+		ret = bmi270_get_filter(data, chan->type, &f);
+		if (ret)
+			return ret;
+
+		*type = IIO_VAL_INT;
+		if (bmi270_filter_averages(chan->type, &f)) {
+			*vals = bmi270_accel_avg_avail;
+			*length = ARRAY_SIZE(bmi270_accel_avg_avail);
+		} else {
+			*vals = bmi270_perf_osr_avail;
+			*length = ARRAY_SIZE(bmi270_perf_osr_avail);
+		}
+		return IIO_AVAIL_LIST;
+	case IIO_CHAN_INFO_LOW_PASS_FILTER_3DB_FREQUENCY:
+		*type = IIO_VAL_INT_PLUS_MICRO;
+		return bmi270_filter_3db_avail(data, chan->type, vals, length);
+	case IIO_CHAN_INFO_CALIBBIAS:
+		*type = IIO_VAL_INT;
+		switch (chan->type) {
+		case IIO_ANGL_VEL:
+			*vals = bmi270_gyro_calibbias_range;
+			*length = ARRAY_SIZE(bmi270_gyro_calibbias_range);
+			return IIO_AVAIL_RANGE;
+		case IIO_ACCEL:
+			*vals = bmi270_accel_calibbias_range;
+			*length = ARRAY_SIZE(bmi270_accel_calibbias_range);
+			return IIO_AVAIL_RANGE;
+		default:
+			return -EINVAL;
+		}
 	default:
 		return -EINVAL;
 	}
@@ -1049,17 +3203,75 @@ static int bmi270_write_event_config(struct iio_dev *indio_dev,
 				     enum iio_event_direction dir, int state)
 {
 	struct bmi270_data *data = iio_priv(indio_dev);
+	enum bmi270_event event;
+	int ret;
+
+	ret = bmi270_init_status(data);
+	if (ret)
+		return ret;
 
 	switch (type) {
 	case IIO_EV_TYPE_MAG_ADAPTIVE:
-		return bmi270_anymotion_event_en(data, chan, state);
+		event = BMI270_EVENT_ANYMO_X + chan->channel2 - IIO_MOD_X;
+		break;
 	case IIO_EV_TYPE_ROC:
-		return bmi270_nomotion_event_en(data, state);
+		event = BMI270_EVENT_NOMO;
+		break;
 	case IIO_EV_TYPE_CHANGE:
-		return bmi270_step_wtrmrk_en(data, state);
+		event = BMI270_EVENT_STEP_WTRMRK;
+		break;
 	default:
 		return -EINVAL;
 	}
+
+	ret = bmi270_pm_get(data);
+	if (ret)
+		return ret;
+
+	/* Features run on accelerometer data, power it before enabling */
+	if (state && !test_bit(event, &data->events_enabled)) {
+		scoped_guard(mutex, &data->mutex)
+			ret = bmi270_power_get(data,
+					       BMI270_PWR_CTRL_ACCEL_EN_MSK);
+		if (ret)
+			goto out;
+	}
+
+	switch (type) {
+	case IIO_EV_TYPE_MAG_ADAPTIVE:
+		ret = bmi270_anymotion_event_en(data, chan, state);
+		break;
+	case IIO_EV_TYPE_ROC:
+		ret = bmi270_nomotion_event_en(data, state);
+		break;
+	default:
+		ret = bmi270_step_wtrmrk_en(data, state);
+		break;
+	}
+
+	/*
+	 * Neither the device nor the accelerometer may power down while an
+	 * event is being watched for.
+	 */
+	if (state && !test_bit(event, &data->events_enabled)) {
+		if (ret) {
+			scoped_guard(mutex, &data->mutex)
+				bmi270_power_put(data,
+						 BMI270_PWR_CTRL_ACCEL_EN_MSK);
+		} else {
+			set_bit(event, &data->events_enabled);
+			pm_runtime_get_noresume(data->dev);
+		}
+	} else if (!state && !ret &&
+		   test_and_clear_bit(event, &data->events_enabled)) {
+		scoped_guard(mutex, &data->mutex)
+			bmi270_power_put(data, BMI270_PWR_CTRL_ACCEL_EN_MSK);
+		pm_runtime_put_noidle(data->dev);
+	}
+
+out:
+	bmi270_pm_put(data);
+	return ret;
 }
 
 static int bmi270_read_event_config(struct iio_dev *indio_dev,
@@ -1072,9 +3284,13 @@ static int bmi270_read_event_config(struct iio_dev *indio_dev,
 	int ret, reg, regval;
 	u16 motion_reg;
 
+	ret = bmi270_init_status(data);
+	if (ret)
+		return ret;
+
 	guard(mutex)(&data->mutex);
 
-	reg = bmi270_int_map_reg(data->irq_pin);
+	reg = bmi270_int_map_reg(data->feat_pin);
 	if (reg < 0)
 		return reg;
 
@@ -1122,14 +3338,11 @@ static int bmi270_read_event_config(struct iio_dev *indio_dev,
 	}
 }
 
-static int bmi270_write_event_value(struct iio_dev *indio_dev,
-				    const struct iio_chan_spec *chan,
-				    enum iio_event_type type,
-				    enum iio_event_direction dir,
-				    enum iio_event_info info,
-				    int val, int val2)
+static int __bmi270_write_event_value(struct bmi270_data *data,
+				      enum iio_event_type type,
+				      enum iio_event_info info,
+				      int val, int val2)
 {
-	struct bmi270_data *data = iio_priv(indio_dev);
 	unsigned int raw, mask, regval;
 	int ret, reg, scale, uscale;
 	u64 tmp;
@@ -1179,6 +3392,29 @@ static int bmi270_write_event_value(struct iio_dev *indio_dev,
 	}
 }
 
+static int bmi270_write_event_value(struct iio_dev *indio_dev,
+				    const struct iio_chan_spec *chan,
+				    enum iio_event_type type,
+				    enum iio_event_direction dir,
+				    enum iio_event_info info,
+				    int val, int val2)
+{
+	struct bmi270_data *data = iio_priv(indio_dev);
+	int ret;
+
+	ret = bmi270_init_status(data);
+	if (ret)
+		return ret;
+
+	ret = bmi270_pm_get(data);
+	if (ret)
+		return ret;
+
+	ret = __bmi270_write_event_value(data, type, info, val, val2);
+	bmi270_pm_put(data);
+	return ret;
+}
+
 static int bmi270_read_event_value(struct iio_dev *indio_dev,
 				   const struct iio_chan_spec *chan,
 				   enum iio_event_type type,
@@ -1192,6 +3428,10 @@ static int bmi270_read_event_value(struct iio_dev *indio_dev,
 	u16 regval;
 	u64 tmp;
 
+	ret = bmi270_init_status(data);
+	if (ret)
+		return ret;
+
 	guard(mutex)(&data->mutex);
 
 	if (type == IIO_EV_TYPE_CHANGE) {
@@ -1257,6 +3497,27 @@ static const struct iio_event_spec bmi270_nomotion_event = {
 	.mask_shared_by_type = BIT(IIO_EV_INFO_VALUE) | BIT(IIO_EV_INFO_PERIOD),
 };
 
+static int bmi270_debugfs_reg_access(struct iio_dev *indio_dev,
+				     unsigned int reg, unsigned int writeval,
+				     unsigned int *readval)
+{
+	struct bmi270_data *data = iio_priv(indio_dev);
+	int ret;
+
+	ret = bmi270_pm_get(data);
+	if (ret)
+		return ret;
+
+	if (readval)
+		ret = regmap_read(data->regmap, reg, readval);
+	else
+		ret = regmap_write(data->regmap, reg, writeval);
+
+	bmi270_pm_put(data);
+
+	return ret;
+}
+
 static const struct iio_info bmi270_info = {
 	.read_raw = bmi270_read_raw,
 	.write_raw = bmi270_write_raw,
@@ -1266,18 +3527,103 @@ static const struct iio_info bmi270_info = {
 	.write_event_value = bmi270_write_event_value,
 	.read_event_value = bmi270_read_event_value,
 	.event_attrs = &bmi270_event_attribute_group,
+	.hwfifo_set_watermark = bmi270_set_watermark,
+	.hwfifo_flush_to_buffer = bmi270_flush_to_buffer,
+	.debugfs_reg_access = bmi270_debugfs_reg_access,
+};
+
+static ssize_t bmi270_decimation_show(struct iio_dev *indio_dev,
+				      uintptr_t private,
+				      const struct iio_chan_spec *chan,
+				      char *buf)
+{
+	struct bmi270_data *data = iio_priv(indio_dev);
+	unsigned int decim;
+
+	scoped_guard(mutex, &data->data_lock)
+		decim = private == BMI270_SCAN_TEMP ? data->temp_decim :
+						      data->steps_decim;
+
+	return sysfs_emit(buf, "%u\n", decim);
+}
+
+static ssize_t bmi270_decimation_store(struct iio_dev *indio_dev,
+				       uintptr_t private,
+				       const struct iio_chan_spec *chan,
+				       const char *buf, size_t len)
+{
+	struct bmi270_data *data = iio_priv(indio_dev);
+	unsigned int decim;
+	int ret;
+
+	ret = kstrtouint(buf, 10, &decim);
+	if (ret)
+		return ret;
+
+	if (!in_range(decim, 1, BMI270_DECIMATION_MAX))
+		return -EINVAL;
+
+	guard(mutex)(&data->data_lock);
+
+	if (private == BMI270_SCAN_TEMP)
+		data->temp_decim = decim;
+	else
+		data->steps_decim = decim;
+
+	return len;
+}
+
+static const struct iio_chan_spec_ext_info bmi270_imu_ext_info[] = {
+	IIO_ENUM("power_mode", IIO_SHARED_BY_TYPE, &bmi270_power_mode_enum),
+	IIO_ENUM_AVAILABLE("power_mode", IIO_SHARED_BY_TYPE,
+			   &bmi270_power_mode_enum),
+	{
+		.name = "calibrate",
+		.shared = IIO_SHARED_BY_TYPE,
+		.write = bmi270_calibrate_store,
+	},
+	{ }
+};
+
+static const struct iio_chan_spec_ext_info bmi270_temp_ext_info[] = {
+	{
+		.name = "decimation",
+		.shared = IIO_SEPARATE,
+		.read = bmi270_decimation_show,
+		.write = bmi270_decimation_store,
+		.private = BMI270_SCAN_TEMP,
+	},
+	{ }
+};
+
+static const struct iio_chan_spec_ext_info bmi270_steps_ext_info[] = {
+	{
+		.name = "decimation",
+		.shared = IIO_SEPARATE,
+		.read = bmi270_decimation_show,
+		.write = bmi270_decimation_store,
+		.private = BMI270_SCAN_STEPS,
+	},
+	{ }
 };
 
 #define BMI270_ACCEL_CHANNEL(_axis) {				\
 	.type = IIO_ACCEL,					\
 	.modified = 1,						\
 	.channel2 = IIO_MOD_##_axis,				\
-	.info_mask_separate = BIT(IIO_CHAN_INFO_RAW),		\
+	.info_mask_separate = BIT(IIO_CHAN_INFO_RAW) |		\
+		BIT(IIO_CHAN_INFO_CALIBBIAS),			\
+	.info_mask_separate_available =				\
+		BIT(IIO_CHAN_INFO_CALIBBIAS),			\
 	.info_mask_shared_by_type = BIT(IIO_CHAN_INFO_SCALE) |	\
-		BIT(IIO_CHAN_INFO_SAMP_FREQ),			\
+		BIT(IIO_CHAN_INFO_SAMP_FREQ) |			\
+		BIT(IIO_CHAN_INFO_OVERSAMPLING_RATIO) |		\
+		BIT(IIO_CHAN_INFO_LOW_PASS_FILTER_3DB_FREQUENCY), \
 	.info_mask_shared_by_type_available =			\
 		BIT(IIO_CHAN_INFO_SCALE) |			\
-		BIT(IIO_CHAN_INFO_SAMP_FREQ),			\
+		BIT(IIO_CHAN_INFO_SAMP_FREQ) |			\
+		BIT(IIO_CHAN_INFO_OVERSAMPLING_RATIO) |		\
+		BIT(IIO_CHAN_INFO_LOW_PASS_FILTER_3DB_FREQUENCY), \
 	.scan_index = BMI270_SCAN_ACCEL_##_axis,		\
 	.scan_type = {						\
 		.sign = 's',					\
@@ -1285,6 +3631,7 @@ static const struct iio_info bmi270_info = {
 		.storagebits = 16,				\
 		.endianness = IIO_LE,				\
 	},	                                                \
+	.ext_info = bmi270_imu_ext_info,			\
 	.event_spec = &bmi270_anymotion_event,			\
 	.num_event_specs = 1,					\
 }
@@ -1293,12 +3640,19 @@ static const struct iio_info bmi270_info = {
 	.type = IIO_ANGL_VEL,					\
 	.modified = 1,						\
 	.channel2 = IIO_MOD_##_axis,				\
-	.info_mask_separate = BIT(IIO_CHAN_INFO_RAW),		\
+	.info_mask_separate = BIT(IIO_CHAN_INFO_RAW) |		\
+		BIT(IIO_CHAN_INFO_CALIBBIAS),			\
+	.info_mask_separate_available =				\
+		BIT(IIO_CHAN_INFO_CALIBBIAS),			\
 	.info_mask_shared_by_type = BIT(IIO_CHAN_INFO_SCALE) |	\
-		BIT(IIO_CHAN_INFO_SAMP_FREQ),			\
+		BIT(IIO_CHAN_INFO_SAMP_FREQ) |			\
+		BIT(IIO_CHAN_INFO_OVERSAMPLING_RATIO) |		\
+		BIT(IIO_CHAN_INFO_LOW_PASS_FILTER_3DB_FREQUENCY), \
 	.info_mask_shared_by_type_available =			\
 		BIT(IIO_CHAN_INFO_SCALE) |			\
-		BIT(IIO_CHAN_INFO_SAMP_FREQ),			\
+		BIT(IIO_CHAN_INFO_SAMP_FREQ) |			\
+		BIT(IIO_CHAN_INFO_OVERSAMPLING_RATIO) |		\
+		BIT(IIO_CHAN_INFO_LOW_PASS_FILTER_3DB_FREQUENCY), \
 	.scan_index = BMI270_SCAN_GYRO_##_axis,			\
 	.scan_type = {						\
 		.sign = 's',					\
@@ -1306,6 +3660,7 @@ static const struct iio_info bmi270_info = {
 		.storagebits = 16,				\
 		.endianness = IIO_LE,				\
 	},	                                                \
+	.ext_info = bmi270_imu_ext_info,			\
 }
 
 static const struct iio_chan_spec bmi270_channels[] = {
@@ -1320,13 +3675,27 @@ static const struct iio_chan_spec bmi270_channels[] = {
 		.info_mask_separate = BIT(IIO_CHAN_INFO_RAW) |
 				      BIT(IIO_CHAN_INFO_SCALE) |
 				      BIT(IIO_CHAN_INFO_OFFSET),
-		.scan_index = -1, /* No buffer support */
+		.scan_index = BMI270_SCAN_TEMP,
+		.scan_type = {
+			.sign = 's',
+			.realbits = 16,
+			.storagebits = 16,
+			.endianness = IIO_LE,
+		},
+		.ext_info = bmi270_temp_ext_info,
 	},
 	{
 		.type = IIO_STEPS,
 		.info_mask_separate = BIT(IIO_CHAN_INFO_ENABLE) |
 				      BIT(IIO_CHAN_INFO_PROCESSED),
-		.scan_index = -1, /* No buffer support */
+		.scan_index = BMI270_SCAN_STEPS,
+		.scan_type = {
+			.sign = 'u',
+			.realbits = 16,
+			.storagebits = 16,
+			.endianness = IIO_LE,
+		},
+		.ext_info = bmi270_steps_ext_info,
 		.event_spec = &bmi270_step_wtrmrk_event,
 		.num_event_specs = 1,
 	},
@@ -1372,45 +3741,29 @@ static int bmi270_int_pin_config(struct bmi270_data *data,
 				  BMI270_INT_IO_LVL_OD_OP_MSK, field_value);
 }
 
-static int bmi270_trigger_probe(struct bmi270_data *data,
-				struct iio_dev *indio_dev)
+static int bmi270_irq_pin_setup(struct bmi270_data *data, int irq,
+				enum bmi270_irq_pin irq_pin, bool *latch)
 {
-	bool open_drain, active_high, latch;
-	struct fwnode_handle *fwnode;
-	enum bmi270_irq_pin irq_pin;
-	int ret, irq, irq_type;
-
-	fwnode = dev_fwnode(data->dev);
-	if (!fwnode)
-		return -ENODEV;
-
-	irq = fwnode_irq_get_byname(fwnode, "INT1");
-	if (irq > 0) {
-		irq_pin = BMI270_IRQ_INT1;
-	} else {
-		irq = fwnode_irq_get_byname(fwnode, "INT2");
-		if (irq < 0)
-			return 0;
-
-		irq_pin = BMI270_IRQ_INT2;
-	}
+	struct fwnode_handle *fwnode = dev_fwnode(data->dev);
+	bool open_drain, active_high;
+	int irq_type;
 
 	irq_type = irq_get_trigger_type(irq);
 	switch (irq_type) {
 	case IRQF_TRIGGER_RISING:
-		latch = false;
+		*latch = false;
 		active_high = true;
 		break;
 	case IRQF_TRIGGER_HIGH:
-		latch = true;
+		*latch = true;
 		active_high = true;
 		break;
 	case IRQF_TRIGGER_FALLING:
-		latch = false;
+		*latch = false;
 		active_high = false;
 		break;
 	case IRQF_TRIGGER_LOW:
-		latch = true;
+		*latch = true;
 		active_high = false;
 		break;
 	default:
@@ -1421,12 +3774,64 @@ static int bmi270_trigger_probe(struct bmi270_data *data,
 
 	open_drain = fwnode_property_read_bool(fwnode, "drive-open-drain");
 
-	ret = bmi270_int_pin_config(data, irq_pin, active_high, open_drain,
-				    latch);
+	return bmi270_int_pin_config(data, irq_pin, active_high, open_drain,
+				     *latch);
+}
+
+/*
+ * With both pins wired, INT1 carries data ready and FIFO interrupts and
+ * INT2 the features, so each handler only reads the status it needs.
+ * A single pin carries everything.
+ */
+static int bmi270_trigger_probe(struct bmi270_data *data,
+				struct iio_dev *indio_dev)
+{
+	enum bmi270_irq_pin irq_pin, feat_pin;
+	struct fwnode_handle *fwnode;
+	int ret, irq, feat_irq;
+	bool latch, feat_latch;
+
+	fwnode = dev_fwnode(data->dev);
+	if (!fwnode)
+		return -ENODEV;
+
+	irq = fwnode_irq_get_byname(fwnode, "INT1");
+	feat_irq = fwnode_irq_get_byname(fwnode, "INT2");
+	if (irq > 0) {
+		irq_pin = BMI270_IRQ_INT1;
+	} else {
+		if (feat_irq < 0)
+			return 0;
+
+		irq = feat_irq;
+		irq_pin = BMI270_IRQ_INT2;
+	}
+
+	if (irq_pin == BMI270_IRQ_INT1 && feat_irq > 0) {
+		feat_pin = BMI270_IRQ_INT2;
+	} else {
+		feat_pin = irq_pin;
+		feat_irq = 0;
+	}
+
+	ret = bmi270_irq_pin_setup(data, irq, irq_pin, &latch);
 	if (ret)
 		return dev_err_probe(data->dev, ret,
 				     "Failed to configure irq line\n");
 
+	if (feat_irq) {
+		ret = bmi270_irq_pin_setup(data, feat_irq, feat_pin,
+					   &feat_latch);
+		if (ret)
+			return dev_err_probe(data->dev, ret,
+					     "Failed to configure irq line\n");
+
+		/* INT_LATCH applies to both pins */
+		if (latch != feat_latch)
+			return dev_err_probe(data->dev, -EINVAL,
+					     "INT1 and INT2 must both be edge or level triggered\n");
+	}
+
 	data->trig = devm_iio_trigger_alloc(data->dev, "%s-trig-%d",
 					    indio_dev->name, irq_pin);
 	if (!data->trig)
@@ -1435,25 +3840,31 @@ static int bmi270_trigger_probe(struct bmi270_data *data,
 	data->trig->ops = &bmi270_trigger_ops;
 	iio_trigger_set_drvdata(data->trig, data);
 
-	ret = devm_request_threaded_irq(data->dev, irq, NULL,
-					bmi270_irq_thread_handler,
+	ret = devm_request_threaded_irq(data->dev, irq, bmi270_irq_handler,
+					feat_irq ? bmi270_data_irq_thread_handler :
+						   bmi270_irq_thread_handler,
 					IRQF_ONESHOT, "bmi270-int", indio_dev);
 	if (ret)
 		return dev_err_probe(data->dev, ret, "Failed to request IRQ\n");
 
+	if (feat_irq) {
+		ret = devm_request_threaded_irq(data->dev, feat_irq, NULL,
+						bmi270_feat_irq_thread_handler,
+						IRQF_ONESHOT, "bmi270-feat",
+						indio_dev);
+		if (ret)
+			return dev_err_probe(data->dev, ret,
+					     "Failed to request IRQ\n");
+	}
+
 	ret = devm_iio_trigger_register(data->dev, data->trig);
 	if (ret)
 		return dev_err_probe(data->dev, ret,
 				     "Trigger registration failed\n");
 
-	/* Disable axes for motion events */
-	ret = bmi270_update_feature_reg(data, BMI270_ANYMO1_REG,
-					BMI270_FEAT_MOTION_XYZ_EN_MSK,
-					FIELD_PREP(BMI270_FEAT_MOTION_XYZ_EN_MSK, 0));
-	if (ret)
-		return ret;
-
 	data->irq_pin = irq_pin;
+	data->feat_pin = feat_pin;
+	data->int_latch = latch;
 
 	return 0;
 }
@@ -1488,11 +3899,9 @@ static int bmi270_validate_chip_id(struct bmi270_data *data)
 	return 0;
 }
 
-static int bmi270_write_calibration_data(struct bmi270_data *data)
+static int bmi270_prepare_init_data(struct bmi270_data *data)
 {
 	int ret;
-	int status = 0;
-	const struct firmware *init_data;
 	struct device *dev = data->dev;
 	struct regmap *regmap = data->regmap;
 
@@ -1515,34 +3924,96 @@ static int bmi270_write_calibration_data(struct bmi270_data *data)
 		return dev_err_probe(dev, ret,
 				     "Failed to prepare device to load init data");
 
-	ret = request_firmware(&init_data, data->chip_info->fw_name, dev);
-	if (ret)
-		return dev_err_probe(dev, ret, "Failed to load init data file");
+	return 0;
+}
 
-	ret = regmap_bulk_write(regmap, BMI270_INIT_DATA_REG,
-				init_data->data, init_data->size);
-	release_firmware(init_data);
-	if (ret)
-		return dev_err_probe(dev, ret, "Failed to write init data");
+/*
+ * Upload the config file in the largest chunks the bus accepts. The chip
+ * does not advance its load pointer across bursts, so each chunk is
+ * preceded by its word offset in INIT_ADDR_0/1.
+ */
+static int bmi270_upload_init_data(struct bmi270_data *data,
+				   const u8 *buf, size_t size)
+{
+	struct regmap *regmap = data->regmap;
+	size_t chunk, pos, len;
+	u64 start;
+	int ret;
+
+	chunk = regmap_get_raw_write_max(regmap);
+	if (!chunk || chunk > size)
+		chunk = size;
+
+	/* Offsets are in words, so chunks must be too */
+	chunk = round_down(chunk, 2);
+	if (!chunk)
+		return -EINVAL;
+
+	start = ktime_get_ns();
+	for (pos = 0; pos < size; pos += len) {
+		len = min(chunk, size - pos);
+
+		data->init_addr[0] = FIELD_GET(BMI270_INIT_ADDR_0_MSK, pos / 2);
+		data->init_addr[1] = FIELD_GET(BMI270_INIT_ADDR_1_MSK, pos / 2);
+		ret = regmap_bulk_write(regmap, BMI270_INIT_ADDR_0_REG,
+					data->init_addr,
+					sizeof(data->init_addr));
+		if (ret)
+			return ret;
+
+		ret = regmap_noinc_write(regmap, BMI270_INIT_DATA_REG,
+					 buf + pos, len);
+		if (ret)
+			return ret;
+	}
+
+	scoped_guard(mutex, &data->mutex) {
+		data->init_chunk = chunk;
+		data->init_bytes = size;
+		data->init_upload_ns = ktime_get_ns() - start;
+	}
+
+	return 0;
+}
+
+static int bmi270_write_init_data(struct bmi270_data *data,
+				  const struct firmware *init_data)
+{
+	int ret;
+	unsigned int status;
+	struct device *dev = data->dev;
+	struct regmap *regmap = data->regmap;
+
+	ret = bmi270_upload_init_data(data, init_data->data, init_data->size);
+	if (ret) {
+		dev_err(dev, "Failed to write init data\n");
+		return ret;
+	}
 
 	ret = regmap_set_bits(regmap, BMI270_INIT_CTRL_REG,
 			      BMI270_INIT_CTRL_LOAD_DONE_MSK);
-	if (ret)
-		return dev_err_probe(dev, ret,
-				     "Failed to stop device initialization");
-
-	/*
-	 * Wait at least 140ms for the device to complete configuration.
-	 * This delay is specified in table C of the datasheet.
-	 */
-	usleep_range(140000, 160000);
+	if (ret) {
+		dev_err(dev, "Failed to stop device initialization\n");
+		return ret;
+	}
 
-	ret = regmap_read(regmap, BMI270_INTERNAL_STATUS_REG, &status);
-	if (ret)
-		return dev_err_probe(dev, ret, "Failed to read internal status");
+	/* Return as soon as the device reports a result instead of waiting */
+	ret = regmap_read_poll_timeout(regmap, BMI270_INTERNAL_STATUS_REG,
+				       status,
+				       FIELD_GET(BMI270_INTERNAL_STATUS_MSG_MSK, status) !=
+				       BMI270_INTERNAL_STATUS_MSG_NOT_INIT,
+				       BMI270_INIT_POLL_US,
+				       BMI270_INIT_TIMEOUT_US);
+	if (ret) {
+		dev_err(dev, "Failed to read internal status\n");
+		return ret;
+	}
 
-	if (status != BMI270_INTERNAL_STATUS_MSG_INIT_OK)
-		return dev_err_probe(dev, -ENODEV, "Device failed to initialize");
+	if (status != BMI270_INTERNAL_STATUS_MSG_INIT_OK) {
+		dev_err(dev, "Device failed to initialize (status 0x%x)\n",
+			status);
+		return -ENODEV;
+	}
 
 	return 0;
 }
@@ -1553,30 +4024,40 @@ static int bmi270_configure_imu(struct bmi270_data *data)
 	struct device *dev = data->dev;
 	struct regmap *regmap = data->regmap;
 
-	ret = regmap_set_bits(regmap, BMI270_PWR_CTRL_REG,
-			      BMI270_PWR_CTRL_AUX_EN_MSK |
-			      BMI270_PWR_CTRL_GYR_EN_MSK |
-			      BMI270_PWR_CTRL_ACCEL_EN_MSK |
-			      BMI270_PWR_CTRL_TEMP_EN_MSK);
+	/* Sensor blocks are powered up on demand by bmi270_power_get() */
+	ret = regmap_write(regmap, BMI270_PWR_CTRL_REG, 0);
 	if (ret)
-		return dev_err_probe(dev, ret, "Failed to enable accelerometer and gyroscope");
-
-	ret = regmap_set_bits(regmap, BMI270_ACC_CONF_REG,
-			      FIELD_PREP(BMI270_ACC_CONF_ODR_MSK,
-					 BMI270_ACC_CONF_ODR_100HZ) |
-			      FIELD_PREP(BMI270_ACC_CONF_BWP_MSK,
-					 BMI270_ACC_CONF_BWP_NORMAL_MODE));
+		return dev_err_probe(dev, ret, "Failed to write power control");
+
+	/* Performance mode filters, without oversampling */
+	ret = regmap_write(regmap, BMI270_ACC_CONF_REG,
+			   FIELD_PREP(BMI270_ACC_CONF_ODR_MSK,
+				      BMI270_ACC_CONF_ODR_100HZ) |
+			   FIELD_PREP(BMI270_ACC_CONF_BWP_MSK,
+				      BMI270_ACC_CONF_BWP_NORMAL_MODE) |
+			   BMI270_ACC_CONF_FILTER_PERF_MSK);
 	if (ret)
 		return dev_err_probe(dev, ret, "Failed to configure accelerometer");
 
-	ret = regmap_set_bits(regmap, BMI270_GYR_CONF_REG,
-			      FIELD_PREP(BMI270_GYR_CONF_ODR_MSK,
-					 BMI270_GYR_CONF_ODR_200HZ) |
-			      FIELD_PREP(BMI270_GYR_CONF_BWP_MSK,
-					 BMI270_GYR_CONF_BWP_NORMAL_MODE));
+	ret = regmap_write(regmap, BMI270_GYR_CONF_REG,
+			   FIELD_PREP(BMI270_GYR_CONF_ODR_MSK,
+				      BMI270_GYR_CONF_ODR_200HZ) |
+			   FIELD_PREP(BMI270_GYR_CONF_BWP_MSK,
+				      BMI270_GYR_CONF_BWP_NORMAL_MODE) |
+			   BMI270_GYR_CONF_NOISE_PERF_MSK |
+			   BMI270_GYR_CONF_FILTER_PERF_MSK);
 	if (ret)
 		return dev_err_probe(dev, ret, "Failed to configure gyroscope");
 
+	/* Offsets reset to zero, so compensation can stay on for good */
+	ret = regmap_set_bits(regmap, BMI270_NV_CONF_REG,
+			      BMI270_NV_CONF_ACC_OFF_EN_MSK);
+	if (!ret)
+		ret = regmap_set_bits(regmap, BMI270_OFFSET_6_REG,
+				      BMI270_OFFSET_6_GYR_OFF_EN_MSK);
+	if (ret)
+		return dev_err_probe(dev, ret, "Failed to enable offset compensation");
+
 	/* Enable FIFO_WKUP, Disable ADV_PWR_SAVE and FUP_EN */
 	ret = regmap_write(regmap, BMI270_PWR_CONF_REG,
 			   BMI270_PWR_CONF_FIFO_WKUP_MSK);
@@ -1594,15 +4075,172 @@ static int bmi270_chip_init(struct bmi270_data *data)
 	if (ret)
 		return ret;
 
-	ret = bmi270_write_calibration_data(data);
+	return bmi270_prepare_init_data(data);
+}
+
+static void bmi270_init_data_loaded(const struct firmware *init_data,
+				    void *context)
+{
+	struct bmi270_data *data = context;
+	int ret;
+
+	if (!init_data) {
+		dev_err(data->dev, "Failed to load init data file\n");
+		ret = -ENOENT;
+		goto out;
+	}
+
+	ret = bmi270_write_init_data(data, init_data);
+	release_firmware(init_data);
 	if (ret)
-		return ret;
+		goto out;
+
+	ret = bmi270_configure_imu(data);
+	if (ret)
+		goto out;
+
+	scoped_guard(mutex, &data->mutex) {
+		ret = bmi270_feat_cache_init(data);
+		if (ret)
+			goto out;
+
+		/* Disable axes for motion events */
+		if (data->irq_pin != BMI270_IRQ_DISABLED)
+			ret = bmi270_update_feature_reg(data, BMI270_ANYMO1_REG,
+							BMI270_FEAT_MOTION_XYZ_EN_MSK,
+							FIELD_PREP(BMI270_FEAT_MOTION_XYZ_EN_MSK, 0));
+	}
+
+out:
+	WRITE_ONCE(data->init_status, ret);
+	complete_all(&data->init_done);
+	bmi270_pm_put(data);
+}
+
+static void bmi270_wait_init(void *context)
+{
+	struct bmi270_data *data = context;
+
+	wait_for_completion(&data->init_done);
+}
+
+static int bmi270_runtime_pm_init(struct bmi270_data *data)
+{
+	int ret;
+
+	/* Stay powered until the upload callback drops this reference */
+	pm_runtime_get_noresume(data->dev);
+	pm_runtime_set_active(data->dev);
+	pm_runtime_set_autosuspend_delay(data->dev,
+					 BMI270_AUTOSUSPEND_DELAY_MS);
+	pm_runtime_use_autosuspend(data->dev);
+	ret = devm_pm_runtime_enable(data->dev);
+	if (ret)
+		pm_runtime_put_noidle(data->dev);
+
+	return ret;
+}
+
+/* Drop the references held by events still enabled at unbind */
+static void bmi270_release_events(void *context)
+{
+	struct bmi270_data *data = context;
+	unsigned long events = xchg(&data->events_enabled, 0);
+	unsigned int event;
+
+	for_each_set_bit(event, &events, BITS_PER_LONG)
+		pm_runtime_put_noidle(data->dev);
+}
+
+static int bmi270_start_init(struct bmi270_data *data)
+{
+	int ret;
+
+	ret = request_firmware_nowait(THIS_MODULE, FW_ACTION_UEVENT,
+				      data->chip_info->fw_name, data->dev,
+				      GFP_KERNEL, data, bmi270_init_data_loaded);
+	if (ret) {
+		pm_runtime_put_noidle(data->dev);
+		return dev_err_probe(data->dev, ret,
+				     "Failed to request init data file\n");
+	}
+
+	/* The upload callback must not outlive the device */
+	return devm_add_action_or_reset(data->dev, bmi270_wait_init, data);
+}
+
+static int bmi270_sensortime_drift_show(struct seq_file *s, void *unused)
+{
+	struct bmi270_data *data = s->private;
+	struct bmi270_sensortime *st = &data->sensortime;
+	s64 drift_ppb;
+
+	guard(mutex)(&data->data_lock);
+
+	drift_ppb = div_s64((st->tick_ps - BMI270_SENSORTIME_TICK_PS) * (s64)NANO,
+			    BMI270_SENSORTIME_TICK_PS);
+
+	seq_printf(s, "tick_ps: %lld\n", st->tick_ps);
+	seq_printf(s, "drift_ppb: %lld\n", drift_ppb);
+	seq_printf(s, "synced: %d\n", st->valid);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(bmi270_sensortime_drift);
+
+static int bmi270_init_upload_show(struct seq_file *s, void *unused)
+{
+	struct bmi270_data *data = s->private;
+	u64 kbps = 0;
+
+	guard(mutex)(&data->mutex);
+
+	if (data->init_upload_ns)
+		kbps = div64_u64((u64)data->init_bytes * NSEC_PER_SEC,
+				 data->init_upload_ns * 1024);
+
+	seq_printf(s, "bytes: %zu\n", data->init_bytes);
+	seq_printf(s, "chunk: %u\n", data->init_chunk);
+	seq_printf(s, "time_us: %llu\n",
+		   div_u64(data->init_upload_ns, NSEC_PER_USEC));
+	seq_printf(s, "throughput_kib_s: %llu\n", kbps);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(bmi270_init_upload);
+
+static int bmi270_wake_latency_show(struct seq_file *s, void *unused)
+{
+	struct bmi270_data *data = s->private;
+
+	seq_printf(s, "last_us: %llu\n",
+		   div_u64(READ_ONCE(data->wake_latency_ns), NSEC_PER_USEC));
+	seq_printf(s, "max_us: %llu\n",
+		   div_u64(READ_ONCE(data->wake_latency_max_ns), NSEC_PER_USEC));
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(bmi270_wake_latency);
+
+/* The IIO core creates the per-device directory for debugfs_reg_access */
+static void bmi270_debugfs_init(struct iio_dev *indio_dev)
+{
+	struct dentry *dir = iio_get_debugfs_dentry(indio_dev);
+
+	if (IS_ERR_OR_NULL(dir))
+		return;
 
-	return bmi270_configure_imu(data);
+	debugfs_create_file("sensortime_drift", 0400, dir, iio_priv(indio_dev),
+			    &bmi270_sensortime_drift_fops);
+	debugfs_create_file("init_upload", 0400, dir, iio_priv(indio_dev),
+			    &bmi270_init_upload_fops);
+	debugfs_create_file("wake_latency", 0400, dir, iio_priv(indio_dev),
+			    &bmi270_wake_latency_fops);
 }
 
 int bmi270_core_probe(struct device *dev, struct regmap *regmap,
-		      const struct bmi270_chip_info *chip_info)
+		      const struct bmi270_chip_info *chip_info,
+		      struct bmi270_transport *transport)
 {
 	int ret;
 	struct bmi270_data *data;
@@ -1615,9 +4253,24 @@ int bmi270_core_probe(struct device *dev, struct regmap *regmap,
 	data = iio_priv(indio_dev);
 	data->dev = dev;
 	data->regmap = regmap;
+	data->transport = transport;
 	data->chip_info = chip_info;
 	data->irq_pin = BMI270_IRQ_DISABLED;
+	data->feat_pin = BMI270_IRQ_DISABLED;
+	data->watermark = 1;
+	data->fifo_read_max = bmi270_fifo_read_limit(data);
+	data->temp_decim = 1;
+	data->steps_decim = 1;
+	data->sensortime.tick_ps = BMI270_SENSORTIME_TICK_PS;
+	data->init_status = -EAGAIN;
 	mutex_init(&data->mutex);
+	mutex_init(&data->data_lock);
+	init_completion(&data->init_done);
+
+	/* At least one frame and the trailing sensortime frame per drain */
+	if (data->fifo_read_max < BMI270_FIFO_FRAME_LEN + 1 +
+				  BMI270_FIFO_SENSORTIME_LEN)
+		return dev_err_probe(dev, -EINVAL, "Bus transfers too short\n");
 
 	ret = bmi270_chip_init(data);
 	if (ret)
@@ -1626,7 +4279,6 @@ int bmi270_core_probe(struct device *dev, struct regmap *regmap,
 	indio_dev->channels = bmi270_channels;
 	indio_dev->num_channels = ARRAY_SIZE(bmi270_channels);
 	indio_dev->name = chip_info->name;
-	indio_dev->available_scan_masks = bmi270_avail_scan_masks;
 	indio_dev->modes = INDIO_DIRECT_MODE;
 	indio_dev->info = &bmi270_info;
 	dev_set_drvdata(data->dev, indio_dev);
@@ -1635,26 +4287,128 @@ int bmi270_core_probe(struct device *dev, struct regmap *regmap,
 	if (ret)
 		return ret;
 
-	ret = devm_iio_triggered_buffer_setup(dev, indio_dev,
-					      iio_pollfunc_store_time,
-					      bmi270_trigger_handler, NULL);
+	ret = devm_iio_triggered_buffer_setup_ext(dev, indio_dev,
+						  iio_pollfunc_store_time,
+						  bmi270_trigger_handler,
+						  IIO_BUFFER_DIRECTION_IN,
+						  &bmi270_buffer_ops,
+						  bmi270_fifo_attributes);
+	if (ret)
+		return ret;
+
+	/* Draining the FIFO relies on the watermark interrupt */
+	if (data->irq_pin != BMI270_IRQ_DISABLED)
+		indio_dev->modes |= INDIO_BUFFER_SOFTWARE;
+
+	/*
+	 * Runtime PM is enabled before and torn down after the IIO device;
+	 * the event references go once userspace can no longer add any.
+	 */
+	ret = bmi270_runtime_pm_init(data);
 	if (ret)
 		return ret;
 
-	return devm_iio_device_register(dev, indio_dev);
+	ret = devm_add_action_or_reset(dev, bmi270_release_events, data);
+	if (ret)
+		goto err_put_init;
+
+	INIT_DELAYED_WORK(&data->raw_work, bmi270_raw_work);
+	ret = devm_add_action_or_reset(dev, bmi270_release_raw, data);
+	if (ret)
+		goto err_put_init;
+
+	ret = devm_iio_device_register(dev, indio_dev);
+	if (ret)
+		goto err_put_init;
+
+	bmi270_debugfs_init(indio_dev);
+
+	return bmi270_start_init(data);
+
+err_put_init:
+	pm_runtime_put_noidle(dev);
+	return ret;
 }
 EXPORT_SYMBOL_GPL(bmi270_core_probe);
 
+/*
+ * Enter advanced power save. Sensor blocks still running have a user that
+ * bmi270_power_get() left them on for, such as the step counter. This goes
+ * around the cache, which keeps the active configuration for resume.
+ */
 static int bmi270_core_runtime_suspend(struct device *dev)
 {
 	struct iio_dev *indio_dev = dev_get_drvdata(dev);
+	struct bmi270_data *data = iio_priv(indio_dev);
+	struct regmap *regmap = data->regmap;
+	unsigned int pwr_conf;
+	int ret;
+
+	ret = iio_device_suspend_triggering(indio_dev);
+	if (ret)
+		return ret;
+
+	ret = regmap_read(regmap, BMI270_PWR_CONF_REG, &pwr_conf);
+	if (ret)
+		return ret;
+
+	regcache_cache_bypass(regmap, true);
+	ret = regmap_write(regmap, BMI270_PWR_CONF_REG,
+			   pwr_conf | BMI270_PWR_CONF_ADV_PWR_SAVE_MSK);
+	regcache_cache_bypass(regmap, false);
+	if (ret)
+		return ret;
 
-	return iio_device_suspend_triggering(indio_dev);
+	regcache_cache_only(regmap, true);
+	return 0;
 }
 
 static int bmi270_core_runtime_resume(struct device *dev)
 {
 	struct iio_dev *indio_dev = dev_get_drvdata(dev);
+	struct bmi270_data *data = iio_priv(indio_dev);
+	struct regmap *regmap = data->regmap;
+	unsigned int pwr_conf, pwr_ctrl;
+	u64 start, latency;
+	int ret;
+
+	start = ktime_get_ns();
+	regcache_cache_only(regmap, false);
+
+	ret = regmap_read(regmap, BMI270_PWR_CONF_REG, &pwr_conf);
+	if (ret)
+		return ret;
+
+	ret = regmap_read(regmap, BMI270_PWR_CTRL_REG, &pwr_ctrl);
+	if (ret)
+		return ret;
+
+	/*
+	 * Leave advanced power save first, the other registers can only be
+	 * written at full speed 450us later.
+	 */
+	regcache_cache_bypass(regmap, true);
+	ret = regmap_write(regmap, BMI270_PWR_CONF_REG, pwr_conf);
+	regcache_cache_bypass(regmap, false);
+	if (ret)
+		return ret;
+
+	usleep_range(450, 1000);
+
+	/* Push configuration changed while suspended out to the device */
+	ret = regcache_sync(regmap);
+	if (ret)
+		return ret;
+
+	/* Return as soon as every running sensor has produced a sample */
+	ret = bmi270_wait_data_ready(data, pwr_ctrl);
+	if (ret)
+		return ret;
+
+	latency = ktime_get_ns() - start;
+	WRITE_ONCE(data->wake_latency_ns, latency);
+	if (latency > data->wake_latency_max_ns)
+		WRITE_ONCE(data->wake_latency_max_ns, latency);
 
 	return iio_device_resume_triggering(indio_dev);
 }
@@ -1667,3 +4421,7 @@ EXPORT_SYMBOL_GPL(bmi270_core_pm_ops);
 MODULE_AUTHOR("Alex Lanzano");
 MODULE_DESCRIPTION("BMI270 driver");
 MODULE_LICENSE("GPL");
+
+#if IS_ENABLED(CONFIG_BMI270_KUNIT_TEST)
+#include "bmi270_kunit.c"
+#endif
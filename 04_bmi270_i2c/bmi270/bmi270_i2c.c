@@ -12,6 +12,10 @@
 static const struct regmap_config bmi270_i2c_regmap_config = {
 	.reg_bits = 8,
 	.val_bits = 8,
+	.max_register = BMI270_MAX_REGISTER,
+	.volatile_table = &bmi270_volatile_table,
+	.precious_table = &bmi270_precious_table,
+	.cache_type = REGCACHE_MAPLE,
 };
 
 static int bmi270_i2c_probe(struct i2c_client *client)
@@ -29,7 +33,7 @@ static int bmi270_i2c_probe(struct i2c_client *client)
 		return dev_err_probe(dev, PTR_ERR(regmap),
 				     "Failed to init i2c regmap");
 
-	return bmi270_core_probe(dev, regmap, chip_info);
+	return bmi270_core_probe(dev, regmap, chip_info, NULL);
 }
 
 static const struct i2c_device_id bmi270_i2c_id[] = {
@@ -59,6 +63,7 @@ static struct i2c_driver bmi270_i2c_driver = {
 	.driver = {
 		.name = "bmi270_i2c",
 		.pm = pm_ptr(&bmi270_core_pm_ops),
+		.probe_type = PROBE_PREFER_ASYNCHRONOUS,
 		.acpi_match_table = bmi270_acpi_match,
 		.of_match_table = bmi270_of_match,
 	},
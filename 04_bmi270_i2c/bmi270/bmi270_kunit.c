@@ -0,0 +1,532 @@
+// SPDX-License-Identifier: (GPL-2.0-only OR BSD-2-Clause)
+/*
+ * KUnit tests for the BMI270 core. This file is included from
+ * bmi270_core.c so the tests can reach its static helpers.
+ *
+ * The device is a register file behind a regmap bus that counts every
+ * transfer and logs the writes. The feature window at 0x30-0x3f is backed
+ * by one bank per FEAT_PAGE value, as on the chip. FIFO_DATA serves a
+ * canned FIFO dump and, past its end, over-read bytes.
+ */
+
+#include <kunit/device.h>
+#include <kunit/test.h>
+#include <linux/kthread.h>
+
+#define BMI270_TEST_FEAT_PAGES		8
+#define BMI270_TEST_FEAT_LEN		(BMI270_FEAT_DATA_END_REG - \
+					 BMI270_FEAT_DATA_START_REG + 1)
+#define BMI270_TEST_LOG_LEN		64
+#define BMI270_TEST_FIFO_LEN		64
+/* Data header without sensor flags, returned once the FIFO is empty */
+#define BMI270_TEST_FIFO_EMPTY		0x80
+/* 100Hz */
+#define BMI270_TEST_FRAME_TICKS		256
+#define BMI270_TEST_STRESS_SAMPLES	2000
+/* 1600Hz, in sensortime ticks and in ns */
+#define BMI270_TEST_STRESS_TICKS	16
+#define BMI270_TEST_STRESS_PERIOD_NS	625000
+
+struct bmi270_test_write {
+	u8 reg;
+	u8 len;
+	/* First byte written */
+	u8 val;
+};
+
+struct bmi270_test_bus {
+	u8 regs[BMI270_MAX_REGISTER + 1];
+	u8 feat[BMI270_TEST_FEAT_PAGES][BMI270_TEST_FEAT_LEN];
+	u8 fifo[BMI270_TEST_FIFO_LEN];
+	unsigned int fifo_len;
+	unsigned int reads;
+	unsigned int writes;
+	struct bmi270_test_write log[BMI270_TEST_LOG_LEN];
+};
+
+struct bmi270_test_ctx {
+	struct bmi270_test_bus *bus;
+	struct iio_dev *indio_dev;
+	struct bmi270_data *data;
+};
+
+static u8 *bmi270_test_reg(struct bmi270_test_bus *bus, unsigned int reg)
+{
+	unsigned int page;
+
+	if (reg < BMI270_FEAT_DATA_START_REG || reg > BMI270_FEAT_DATA_END_REG)
+		return &bus->regs[reg];
+
+	page = bus->regs[BMI270_FEAT_PAGE_REG] & BMI270_FEAT_PAGE_MSK;
+	return &bus->feat[page][reg - BMI270_FEAT_DATA_START_REG];
+}
+
+static int bmi270_test_bus_write(void *context, const void *data, size_t count)
+{
+	struct bmi270_test_bus *bus = context;
+	const u8 *buf = data;
+	unsigned int reg = buf[0], i;
+
+	if (count < 2 || reg + count - 1 > BMI270_MAX_REGISTER + 1)
+		return -EINVAL;
+
+	if (bus->writes < BMI270_TEST_LOG_LEN) {
+		bus->log[bus->writes].reg = reg;
+		bus->log[bus->writes].len = count - 1;
+		bus->log[bus->writes].val = buf[1];
+	}
+	bus->writes++;
+
+	for (i = 1; i < count; i++)
+		*bmi270_test_reg(bus, reg + i - 1) = buf[i];
+
+	return 0;
+}
+
+static int bmi270_test_bus_read(void *context, const void *reg_buf,
+				size_t reg_size, void *val_buf, size_t val_size)
+{
+	struct bmi270_test_bus *bus = context;
+	unsigned int reg = *(const u8 *)reg_buf, i;
+	u8 *val = val_buf;
+
+	if (reg + val_size > BMI270_MAX_REGISTER + 1)
+		return -EINVAL;
+
+	bus->reads++;
+
+	if (reg == BMI270_FIFO_DATA_REG) {
+		for (i = 0; i < val_size; i++)
+			val[i] = i < bus->fifo_len ? bus->fifo[i] :
+						     BMI270_TEST_FIFO_EMPTY;
+		return 0;
+	}
+
+	for (i = 0; i < val_size; i++)
+		val[i] = *bmi270_test_reg(bus, reg + i);
+
+	return 0;
+}
+
+static const struct regmap_bus bmi270_test_regmap_bus = {
+	.read = bmi270_test_bus_read,
+	.write = bmi270_test_bus_write,
+};
+
+/* Same as the I2C transport */
+static const struct regmap_config bmi270_test_regmap_config = {
+	.reg_bits = 8,
+	.val_bits = 8,
+	.max_register = BMI270_MAX_REGISTER,
+	.volatile_table = &bmi270_volatile_table,
+	.precious_table = &bmi270_precious_table,
+	.cache_type = REGCACHE_MAPLE,
+};
+
+static void bmi270_test_reset_counts(struct bmi270_test_bus *bus)
+{
+	bus->reads = 0;
+	bus->writes = 0;
+}
+
+static int bmi270_test_init(struct kunit *test)
+{
+	struct bmi270_test_ctx *ctx;
+	struct iio_dev *indio_dev;
+	struct bmi270_data *data;
+	struct regmap *regmap;
+	struct device *dev;
+
+	ctx = kunit_kzalloc(test, sizeof(*ctx), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, ctx);
+
+	ctx->bus = kunit_kzalloc(test, sizeof(*ctx->bus), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, ctx->bus);
+
+	dev = kunit_device_register(test, "bmi270-test");
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, dev);
+
+	regmap = devm_regmap_init(dev, &bmi270_test_regmap_bus, ctx->bus,
+				  &bmi270_test_regmap_config);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, regmap);
+
+	indio_dev = devm_iio_device_alloc(dev, sizeof(*data));
+	KUNIT_ASSERT_NOT_NULL(test, indio_dev);
+
+	data = iio_priv(indio_dev);
+	data->dev = dev;
+	data->regmap = regmap;
+	data->chip_info = &bmi270_chip_info;
+	mutex_init(&data->mutex);
+	mutex_init(&data->data_lock);
+	dev_set_drvdata(dev, indio_dev);
+
+	ctx->indio_dev = indio_dev;
+	ctx->data = data;
+	test->priv = ctx;
+
+	return 0;
+}
+
+/* Shadowed feature registers are read without touching the bus */
+static void bmi270_test_feat_read_cached(struct kunit *test)
+{
+	struct bmi270_test_ctx *ctx = test->priv;
+	u16 val;
+
+	put_unaligned_le16(0x1234, &ctx->bus->feat[2][0]);
+
+	KUNIT_ASSERT_EQ(test, bmi270_feat_cache_init(ctx->data), 0);
+	bmi270_test_reset_counts(ctx->bus);
+
+	KUNIT_ASSERT_EQ(test, bmi270_read_feature_reg(ctx->data,
+						      BMI270_NOMO1_REG, &val), 0);
+	KUNIT_EXPECT_EQ(test, val, 0x1234);
+	KUNIT_EXPECT_EQ(test, ctx->bus->reads, 0);
+	KUNIT_EXPECT_EQ(test, ctx->bus->writes, 0);
+}
+
+/* Adjacent registers on one page: one page select and one bulk write */
+static void bmi270_test_feat_txn_one_page(struct kunit *test)
+{
+	struct bmi270_test_ctx *ctx = test->priv;
+	struct bmi270_test_bus *bus = ctx->bus;
+	struct bmi270_data *data = ctx->data;
+	struct bmi270_feat_txn txn;
+
+	KUNIT_ASSERT_EQ(test, bmi270_feat_cache_init(data), 0);
+	bmi270_test_reset_counts(bus);
+
+	bmi270_feat_txn_begin(&txn);
+	KUNIT_ASSERT_EQ(test, bmi270_feat_txn_update(data, &txn,
+						     BMI270_ANYMO1_REG,
+						     BMI270_FEAT_MOTION_XYZ_EN_MSK,
+						     BMI270_FEAT_MOTION_XYZ_EN_MSK), 0);
+	KUNIT_ASSERT_EQ(test, bmi270_feat_txn_update(data, &txn,
+						     BMI270_ANYMO2_REG,
+						     BMI270_FEAT_MOTION_ENABLE_MSK,
+						     BMI270_FEAT_MOTION_ENABLE_MSK), 0);
+	KUNIT_ASSERT_EQ(test, bmi270_feat_txn_commit(data, &txn), 0);
+
+	KUNIT_EXPECT_EQ(test, bus->reads, 0);
+	KUNIT_EXPECT_EQ(test, bus->writes, 2);
+	KUNIT_EXPECT_EQ(test, bus->log[0].reg, BMI270_FEAT_PAGE_REG);
+	KUNIT_EXPECT_EQ(test, bus->log[0].val, 1);
+	KUNIT_EXPECT_EQ(test, bus->log[1].reg,
+			bmi270_feature_regs[BMI270_ANYMO1_REG].addr);
+	KUNIT_EXPECT_EQ(test, bus->log[1].len, 4);
+
+	KUNIT_EXPECT_EQ(test, get_unaligned_le16(&bus->feat[1][0x0c]),
+			BMI270_FEAT_MOTION_XYZ_EN_MSK);
+	KUNIT_EXPECT_EQ(test, get_unaligned_le16(&bus->feat[1][0x0e]),
+			BMI270_FEAT_MOTION_ENABLE_MSK);
+
+	/* The page is still selected, so the next commit skips FEAT_PAGE */
+	bmi270_test_reset_counts(bus);
+	KUNIT_ASSERT_EQ(test, bmi270_update_feature_reg(data, BMI270_ANYMO2_REG,
+							BMI270_FEAT_MOTION_ENABLE_MSK,
+							0), 0);
+	KUNIT_EXPECT_EQ(test, bus->reads, 0);
+	KUNIT_EXPECT_EQ(test, bus->writes, 1);
+	KUNIT_EXPECT_EQ(test, get_unaligned_le16(&bus->feat[1][0x0e]), 0);
+}
+
+/* Updates spanning two pages: each page is selected and written once */
+static void bmi270_test_feat_txn_two_pages(struct kunit *test)
+{
+	struct bmi270_test_ctx *ctx = test->priv;
+	struct bmi270_test_bus *bus = ctx->bus;
+	struct bmi270_data *data = ctx->data;
+	struct bmi270_feat_txn txn;
+
+	KUNIT_ASSERT_EQ(test, bmi270_feat_cache_init(data), 0);
+	bmi270_test_reset_counts(bus);
+
+	bmi270_feat_txn_begin(&txn);
+	KUNIT_ASSERT_EQ(test, bmi270_feat_txn_update(data, &txn,
+						     BMI270_NOMO2_REG,
+						     BMI270_FEAT_MOTION_ENABLE_MSK,
+						     BMI270_FEAT_MOTION_ENABLE_MSK), 0);
+	KUNIT_ASSERT_EQ(test, bmi270_feat_txn_update(data, &txn,
+						     BMI270_ANYMO2_REG,
+						     BMI270_FEAT_MOTION_ENABLE_MSK,
+						     BMI270_FEAT_MOTION_ENABLE_MSK), 0);
+	KUNIT_ASSERT_EQ(test, bmi270_feat_txn_update(data, &txn,
+						     BMI270_NOMO1_REG,
+						     BMI270_FEAT_MOTION_XYZ_EN_MSK,
+						     BMI270_FEAT_MOTION_XYZ_EN_MSK), 0);
+	KUNIT_ASSERT_EQ(test, bmi270_feat_txn_commit(data, &txn), 0);
+
+	KUNIT_EXPECT_EQ(test, bus->reads, 0);
+	KUNIT_EXPECT_EQ(test, bus->writes, 4);
+	KUNIT_EXPECT_EQ(test, bus->log[0].reg, BMI270_FEAT_PAGE_REG);
+	KUNIT_EXPECT_EQ(test, bus->log[0].val, 1);
+	KUNIT_EXPECT_EQ(test, bus->log[1].len, 2);
+	KUNIT_EXPECT_EQ(test, bus->log[2].reg, BMI270_FEAT_PAGE_REG);
+	KUNIT_EXPECT_EQ(test, bus->log[2].val, 2);
+	KUNIT_EXPECT_EQ(test, bus->log[3].reg,
+			bmi270_feature_regs[BMI270_NOMO1_REG].addr);
+	KUNIT_EXPECT_EQ(test, bus->log[3].len, 4);
+}
+
+/*
+ * Suspend only sets advanced power save, around the cache. Resume clears
+ * it before anything else, then writes back configuration changed while
+ * suspended and waits for the running sensor's first sample.
+ */
+static void bmi270_test_runtime_pm_sequence(struct kunit *test)
+{
+	struct bmi270_test_ctx *ctx = test->priv;
+	struct bmi270_test_bus *bus = ctx->bus;
+	struct bmi270_data *data = ctx->data;
+	unsigned int val;
+
+	bus->regs[BMI270_PWR_CONF_REG] = BMI270_PWR_CONF_FIFO_WKUP_MSK;
+	bus->regs[BMI270_PWR_CTRL_REG] = BMI270_PWR_CTRL_ACCEL_EN_MSK;
+	bus->regs[BMI270_ACC_CONF_REG] = 0xa8;
+	bus->regs[BMI270_STATUS_REG] = BMI270_STATUS_DRDY_ACC_MSK;
+
+	KUNIT_ASSERT_EQ(test, regmap_read(data->regmap, BMI270_ACC_CONF_REG,
+					  &val), 0);
+	bmi270_test_reset_counts(bus);
+
+	KUNIT_ASSERT_EQ(test, bmi270_core_runtime_suspend(data->dev), 0);
+	KUNIT_EXPECT_EQ(test, bus->writes, 1);
+	KUNIT_EXPECT_EQ(test, bus->log[0].reg, BMI270_PWR_CONF_REG);
+	KUNIT_EXPECT_EQ(test, bus->log[0].val,
+			BMI270_PWR_CONF_FIFO_WKUP_MSK |
+			BMI270_PWR_CONF_ADV_PWR_SAVE_MSK);
+
+	/* Suspended: the change only reaches the cache */
+	KUNIT_ASSERT_EQ(test, regmap_update_bits(data->regmap,
+						 BMI270_ACC_CONF_REG,
+						 BMI270_ACC_CONF_ODR_MSK, 0x09), 0);
+	KUNIT_EXPECT_EQ(test, bus->writes, 1);
+	KUNIT_EXPECT_EQ(test, bus->regs[BMI270_ACC_CONF_REG], 0xa8);
+
+	bmi270_test_reset_counts(bus);
+	KUNIT_ASSERT_EQ(test, bmi270_core_runtime_resume(data->dev), 0);
+
+	KUNIT_ASSERT_GE(test, bus->writes, 2);
+	KUNIT_EXPECT_EQ(test, bus->log[0].reg, BMI270_PWR_CONF_REG);
+	KUNIT_EXPECT_EQ(test, bus->log[0].val, BMI270_PWR_CONF_FIFO_WKUP_MSK);
+	KUNIT_EXPECT_EQ(test, bus->regs[BMI270_PWR_CONF_REG],
+			BMI270_PWR_CONF_FIFO_WKUP_MSK);
+	KUNIT_EXPECT_EQ(test, bus->regs[BMI270_ACC_CONF_REG], 0xa9);
+	KUNIT_EXPECT_GT(test, data->wake_latency_ns, 0);
+}
+
+/*
+ * Headered FIFO frames: skip (frames lost), sensortime, input config
+ * (sensor configuration changed), then gyro and accel data. A frame cut
+ * off by the end of the read is left in place.
+ */
+static void bmi270_test_fifo_next_frame(struct kunit *test)
+{
+	static const u8 fifo[] = {
+		0x40, 0x01,
+		0x44, 0x00, 0x10, 0x00,
+		0x48, 0x01, 0x00, 0x00, 0x00,
+		0x8c, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16,
+		      0x21, 0x22, 0x23, 0x24, 0x25, 0x26,
+		0x84, 0x31, 0x32,
+	};
+	static const struct {
+		u8 header;
+		int payload;
+	} frames[] = {
+		{ 0x40, 1 },
+		{ 0x44, 3 },
+		{ 0x48, 7 },
+		{ 0x8c, 12 },
+	};
+	static const u8 empty[] = { BMI270_TEST_FIFO_EMPTY, 0x00, 0x00 };
+	unsigned int pos = 0, i;
+	u8 header;
+
+	for (i = 0; i < ARRAY_SIZE(frames); i++) {
+		KUNIT_EXPECT_EQ(test, bmi270_fifo_next_frame(fifo, sizeof(fifo),
+							     &pos, &header),
+				frames[i].payload);
+		KUNIT_EXPECT_EQ(test, header, frames[i].header);
+	}
+
+	KUNIT_EXPECT_EQ(test, bmi270_fifo_next_frame(fifo, sizeof(fifo), &pos,
+						     &header), -ENODATA);
+	KUNIT_EXPECT_EQ(test, pos, 24);
+
+	pos = 0;
+	KUNIT_EXPECT_EQ(test, bmi270_fifo_next_frame(empty, sizeof(empty), &pos,
+						     &header), -ENODATA);
+}
+
+/* Reading past the last frame returns the sensortime frame */
+static const u8 bmi270_test_fifo[] = {
+	/* Two frames lost */
+	0x40, 0x02,
+	/* Gyro, accel */
+	0x8c, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16,
+	      0x21, 0x22, 0x23, 0x24, 0x25, 0x26,
+	/* Configuration changed */
+	0x48, 0x01, 0x00, 0x00, 0x00,
+	/* Accel only */
+	0x84, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36,
+	/* Sensortime 0x1000 */
+	0x44, 0x00, 0x10, 0x00,
+};
+
+static void bmi270_test_fifo_setup(struct bmi270_test_ctx *ctx)
+{
+	struct bmi270_test_bus *bus = ctx->bus;
+	struct bmi270_data *data = ctx->data;
+
+	memcpy(bus->fifo, bmi270_test_fifo, sizeof(bmi270_test_fifo));
+	bus->fifo_len = sizeof(bmi270_test_fifo);
+	/* FIFO_LENGTH does not count the sensortime frame */
+	bus->regs[BMI270_FIFO_LENGTH_0_REG] = sizeof(bmi270_test_fifo) - 1 -
+					      BMI270_FIFO_SENSORTIME_LEN;
+
+	data->fifo_read_max = sizeof(data->fifo_buf);
+	data->fifo_frame_len = BMI270_FIFO_FRAME_LEN;
+	data->frame_ticks = BMI270_TEST_FRAME_TICKS;
+	data->fifo_next_ticks = 1000;
+}
+
+/*
+ * The whole FIFO in one read: skipped frames count as samples, the
+ * configuration frame is stepped over, and the sensortime frame places
+ * the last data frame. Sensors missing from a frame keep their value.
+ */
+static void bmi270_test_fifo_drain(struct kunit *test)
+{
+	struct bmi270_test_ctx *ctx = test->priv;
+	struct bmi270_data *data = ctx->data;
+
+	bmi270_test_fifo_setup(ctx);
+
+	KUNIT_EXPECT_EQ(test, bmi270_fifo_drain(ctx->indio_dev,
+						BMI270_FIFO_SIZE, false), 4);
+	KUNIT_EXPECT_EQ(test, ctx->bus->reads, 2);
+	KUNIT_EXPECT_TRUE(test, data->fifo_drained);
+
+	/* Sensortime 0x1000 dates the last frame, the next one follows it */
+	KUNIT_EXPECT_EQ(test, data->fifo_next_ticks,
+			0x1000 + BMI270_TEST_FRAME_TICKS);
+
+	KUNIT_EXPECT_MEMEQ(test, &data->samples[BMI270_SCAN_GYRO_X],
+			   &bmi270_test_fifo[3], BMI270_FIFO_ACC_GYR_LEN);
+	KUNIT_EXPECT_MEMEQ(test, &data->samples[BMI270_SCAN_ACCEL_X],
+			   &bmi270_test_fifo[21], BMI270_FIFO_ACC_GYR_LEN);
+}
+
+/* A read capped at one frame cuts the configuration frame in two */
+static void bmi270_test_fifo_drain_partial(struct kunit *test)
+{
+	struct bmi270_test_ctx *ctx = test->priv;
+	struct bmi270_data *data = ctx->data;
+
+	bmi270_test_fifo_setup(ctx);
+
+	KUNIT_EXPECT_EQ(test, bmi270_fifo_drain(ctx->indio_dev, 1, false), 3);
+	KUNIT_EXPECT_FALSE(test, data->fifo_drained);
+	KUNIT_EXPECT_EQ(test, data->fifo_next_ticks,
+			1000 + 3 * BMI270_TEST_FRAME_TICKS);
+
+	KUNIT_EXPECT_MEMEQ(test, &data->samples[BMI270_SCAN_ACCEL_X],
+			   &bmi270_test_fifo[9], BMI270_FIFO_ACC_GYR_LEN);
+}
+
+struct bmi270_test_hammer {
+	struct bmi270_data *data;
+	unsigned int ops;
+	int err;
+};
+
+/* What sysfs does to the range and rate attributes, as fast as it can */
+static int bmi270_test_hammer_fn(void *arg)
+{
+	struct bmi270_test_hammer *h = arg;
+	struct bmi270_data *data = h->data;
+	int val, val2, ret;
+
+	while (!kthread_should_stop()) {
+		ret = bmi270_set_scale(data, IIO_ACCEL,
+				       bmi270_accel_scale[h->ops & 1].uscale);
+		if (!ret)
+			ret = bmi270_get_scale(data, IIO_ACCEL, &val, &val2);
+		if (!ret)
+			ret = bmi270_get_odr(data, IIO_ACCEL, &val, &val2);
+		if (ret && !h->err)
+			h->err = ret;
+
+		h->ops++;
+		usleep_range(20, 50);
+	}
+
+	return 0;
+}
+
+/*
+ * Stream at 1600Hz while another thread keeps writing and reading the
+ * configuration. A sample whose read does not finish within its period
+ * is counted as missed: the data path must never wait for data->mutex.
+ */
+static void bmi270_test_stream_stress(struct kunit *test)
+{
+	struct bmi270_test_ctx *ctx = test->priv;
+	struct bmi270_data *data = ctx->data;
+	struct bmi270_test_hammer h = { .data = data };
+	struct task_struct *task;
+	unsigned int i, missed = 0, failed = 0;
+	s64 start, elapsed;
+
+	/* Accel at 1600Hz */
+	ctx->bus->regs[BMI270_ACC_CONF_REG] = 0xac;
+	data->burst_first = 0;
+	data->burst_len = BMI270_DATA_BURST_LEN;
+	data->frame_ticks = BMI270_TEST_STRESS_TICKS;
+
+	task = kthread_run(bmi270_test_hammer_fn, &h, "bmi270-hammer");
+	KUNIT_ASSERT_FALSE(test, IS_ERR(task));
+
+	for (i = 0; i < BMI270_TEST_STRESS_SAMPLES; i++) {
+		start = ktime_get_ns();
+		if (bmi270_read_sample(ctx->indio_dev, ktime_get_boottime_ns()))
+			failed++;
+		elapsed = ktime_get_ns() - start;
+
+		if (elapsed > BMI270_TEST_STRESS_PERIOD_NS)
+			missed++;
+
+		usleep_range(100, 200);
+	}
+
+	kthread_stop(task);
+
+	kunit_info(test, "%u samples, %u missed, %u configuration rounds\n",
+		   BMI270_TEST_STRESS_SAMPLES, missed, h.ops);
+
+	KUNIT_EXPECT_EQ(test, failed, 0);
+	KUNIT_EXPECT_EQ(test, missed, 0);
+	KUNIT_EXPECT_EQ(test, h.err, 0);
+	KUNIT_EXPECT_GT(test, h.ops, 0);
+}
+
+static struct kunit_case bmi270_test_cases[] = {
+	KUNIT_CASE(bmi270_test_feat_read_cached),
+	KUNIT_CASE(bmi270_test_feat_txn_one_page),
+	KUNIT_CASE(bmi270_test_feat_txn_two_pages),
+	KUNIT_CASE(bmi270_test_runtime_pm_sequence),
+	KUNIT_CASE(bmi270_test_fifo_next_frame),
+	KUNIT_CASE(bmi270_test_fifo_drain),
+	KUNIT_CASE(bmi270_test_fifo_drain_partial),
+	KUNIT_CASE_SLOW(bmi270_test_stream_stress),
+	{ }
+};
+
+static struct kunit_suite bmi270_test_suite = {
+	.name = "bmi270",
+	.init = bmi270_test_init,
+	.test_cases = bmi270_test_cases,
+};
+kunit_test_suite(bmi270_test_suite);
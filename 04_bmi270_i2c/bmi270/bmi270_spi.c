@@ -1,6 +1,7 @@
 // SPDX-License-Identifier: (GPL-2.0-only OR BSD-2-Clause)
 
 #include <linux/iio/iio.h>
+#include <linux/minmax.h>
 #include <linux/mod_devicetable.h>
 #include <linux/module.h>
 #include <linux/pm.h>
@@ -39,30 +40,221 @@ static const struct regmap_bus bmi270_regmap_bus = {
 	.write = bmi270_regmap_spi_write,
 };
 
+/*
+ * Let regmap know how large a write the controller can take, so that the
+ * config file upload can be split into the largest possible bursts.
+ */
+static const struct regmap_bus *bmi270_spi_regmap_bus(struct spi_device *spi)
+{
+	size_t max = spi_max_transfer_size(spi);
+	struct regmap_bus *bus;
+
+	if (max == SIZE_MAX)
+		return &bmi270_regmap_bus;
+
+	bus = devm_kmemdup(&spi->dev, &bmi270_regmap_bus, sizeof(*bus),
+			   GFP_KERNEL);
+	if (!bus)
+		return ERR_PTR(-ENOMEM);
+
+	/* The register address byte goes out in the same transfer */
+	bus->max_raw_write = max - 1;
+	return bus;
+}
+
+/* Command byte and the dummy byte every read starts with */
+#define BMI270_SPI_READ_HDR	2
+#define BMI270_SPI_READ		BIT(7)
+
+/*
+ * Sample data fast path. spi_write_then_read() takes a global lock and
+ * copies through a bounce buffer on every call, which dominates a 15 byte
+ * burst at high output data rates. Instead the data burst is a single
+ * full-duplex transfer built and optimized once per buffer enable, and
+ * FIFO reads reuse a preallocated transfer. All buffers are DMA-safe.
+ */
+struct bmi270_spi {
+	struct bmi270_transport transport;
+	struct spi_device *spi;
+	/* Longest single transfer the controller takes, header included */
+	size_t max_xfer;
+
+	struct spi_transfer stream_xfer;
+	struct spi_message stream_msg;
+	bool stream_optimized;
+	size_t stream_len;
+
+	struct spi_transfer fifo_xfer;
+	struct spi_message fifo_msg;
+	u8 *fifo_tx;
+	u8 *fifo_rx;
+
+	u8 stream_tx[BMI270_SPI_READ_HDR + BMI270_DATA_BURST_LEN]
+		__aligned(IIO_DMA_MINALIGN);
+	u8 stream_rx[BMI270_SPI_READ_HDR + BMI270_DATA_BURST_LEN]
+		__aligned(IIO_DMA_MINALIGN);
+};
+
+static struct bmi270_spi *to_bmi270_spi(struct bmi270_transport *tr)
+{
+	return container_of(tr, struct bmi270_spi, transport);
+}
+
+static void bmi270_spi_stream_release(struct bmi270_spi *st)
+{
+	if (!st->stream_optimized)
+		return;
+
+	spi_unoptimize_message(&st->stream_msg);
+	st->stream_optimized = false;
+}
+
+static int bmi270_spi_stream_prepare(struct bmi270_transport *tr,
+				     unsigned int reg, size_t len)
+{
+	struct bmi270_spi *st = to_bmi270_spi(tr);
+
+	if (len > BMI270_DATA_BURST_LEN ||
+	    len + BMI270_SPI_READ_HDR > st->max_xfer)
+		return -EINVAL;
+
+	bmi270_spi_stream_release(st);
+
+	st->stream_tx[0] = reg | BMI270_SPI_READ;
+
+	st->stream_xfer = (struct spi_transfer) {
+		.tx_buf = st->stream_tx,
+		.rx_buf = st->stream_rx,
+		.len = len + BMI270_SPI_READ_HDR,
+	};
+	spi_message_init_with_transfers(&st->stream_msg, &st->stream_xfer, 1);
+	st->stream_len = len;
+
+	/* Not fatal, spi_sync() optimizes unoptimized messages on the fly */
+	if (!spi_optimize_message(st->spi, &st->stream_msg))
+		st->stream_optimized = true;
+
+	return 0;
+}
+
+static int bmi270_spi_stream_read(struct bmi270_transport *tr, void *buf)
+{
+	struct bmi270_spi *st = to_bmi270_spi(tr);
+	int ret;
+
+	ret = spi_sync(st->spi, &st->stream_msg);
+	if (ret)
+		return ret;
+
+	memcpy(buf, st->stream_rx + BMI270_SPI_READ_HDR, st->stream_len);
+	return 0;
+}
+
+/*
+ * The device resends a frame that was read only in part, so FIFO_DATA is
+ * always read in a single transfer; the core keeps reads within
+ * fifo_read_max.
+ */
+static int bmi270_spi_fifo_read(struct bmi270_transport *tr,
+				unsigned int reg, void *buf, size_t len)
+{
+	struct bmi270_spi *st = to_bmi270_spi(tr);
+	int ret;
+
+	if (len > tr->fifo_read_max)
+		return -EINVAL;
+
+	st->fifo_tx[0] = reg | BMI270_SPI_READ;
+	st->fifo_xfer.len = len + BMI270_SPI_READ_HDR;
+
+	ret = spi_sync(st->spi, &st->fifo_msg);
+	if (ret)
+		return ret;
+
+	memcpy(buf, st->fifo_rx + BMI270_SPI_READ_HDR, len);
+	return 0;
+}
+
+static const struct bmi270_transport_ops bmi270_spi_transport_ops = {
+	.stream_prepare = bmi270_spi_stream_prepare,
+	.stream_read = bmi270_spi_stream_read,
+	.fifo_read = bmi270_spi_fifo_read,
+};
+
+static void bmi270_spi_transport_release(void *st)
+{
+	bmi270_spi_stream_release(st);
+}
+
+static struct bmi270_transport *bmi270_spi_transport(struct spi_device *spi)
+{
+	struct device *dev = &spi->dev;
+	struct bmi270_spi *st;
+	int ret;
+
+	st = devm_kzalloc(dev, sizeof(*st), GFP_KERNEL);
+	if (!st)
+		return ERR_PTR(-ENOMEM);
+
+	st->spi = spi;
+	st->transport.ops = &bmi270_spi_transport_ops;
+	st->max_xfer = min_t(size_t, spi_max_transfer_size(spi),
+			     BMI270_FIFO_READ_MAX + BMI270_SPI_READ_HDR);
+	st->transport.fifo_read_max = st->max_xfer - BMI270_SPI_READ_HDR;
+
+	st->fifo_tx = devm_kzalloc(dev, st->max_xfer, GFP_KERNEL);
+	st->fifo_rx = devm_kzalloc(dev, st->max_xfer, GFP_KERNEL);
+	if (!st->fifo_tx || !st->fifo_rx)
+		return ERR_PTR(-ENOMEM);
+
+	st->fifo_xfer.tx_buf = st->fifo_tx;
+	st->fifo_xfer.rx_buf = st->fifo_rx;
+	spi_message_init_with_transfers(&st->fifo_msg, &st->fifo_xfer, 1);
+
+	ret = devm_add_action_or_reset(dev, bmi270_spi_transport_release, st);
+	if (ret)
+		return ERR_PTR(ret);
+
+	return &st->transport;
+}
+
 static const struct regmap_config bmi270_spi_regmap_config = {
 	.reg_bits = 8,
 	.val_bits = 8,
 	.pad_bits = 8,
 	.read_flag_mask = BIT(7),
+	.max_register = BMI270_MAX_REGISTER,
+	.volatile_table = &bmi270_volatile_table,
+	.precious_table = &bmi270_precious_table,
+	.cache_type = REGCACHE_MAPLE,
 };
 
 static int bmi270_spi_probe(struct spi_device *spi)
 {
 	struct regmap *regmap;
 	struct device *dev = &spi->dev;
+	const struct regmap_bus *bus;
+	struct bmi270_transport *transport;
 	const struct bmi270_chip_info *chip_info;
 
 	chip_info = spi_get_device_match_data(spi);
 	if (!chip_info)
 		return -ENODEV;
 
-	regmap = devm_regmap_init(dev, &bmi270_regmap_bus, dev,
-				  &bmi270_spi_regmap_config);
+	bus = bmi270_spi_regmap_bus(spi);
+	if (IS_ERR(bus))
+		return PTR_ERR(bus);
+
+	regmap = devm_regmap_init(dev, bus, dev, &bmi270_spi_regmap_config);
 	if (IS_ERR(regmap))
 		return dev_err_probe(dev, PTR_ERR(regmap),
 				     "Failed to init spi regmap\n");
 
-	return bmi270_core_probe(dev, regmap, chip_info);
+	transport = bmi270_spi_transport(spi);
+	if (IS_ERR(transport))
+		return PTR_ERR(transport);
+
+	return bmi270_core_probe(dev, regmap, chip_info, transport);
 }
 
 static const struct spi_device_id bmi270_spi_id[] = {
@@ -81,6 +273,7 @@ static struct spi_driver bmi270_spi_driver = {
 	.driver = {
 		.name = "bmi270",
 		.pm = pm_ptr(&bmi270_core_pm_ops),
+		.probe_type = PROBE_PREFER_ASYNCHRONOUS,
 		.of_match_table = bmi270_of_match,
 	},
 	.probe = bmi270_spi_probe,
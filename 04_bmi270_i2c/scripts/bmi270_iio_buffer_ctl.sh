@@ -97,13 +97,24 @@ enable_needed_channels() {
     exit 1
   fi
 
-  sysfs_write "$SE/in_accel_x_en" 1
-  sysfs_write "$SE/in_accel_y_en" 1
-  sysfs_write "$SE/in_accel_z_en" 1
-
-  sysfs_write "$SE/in_anglvel_x_en" 1
-  sysfs_write "$SE/in_anglvel_y_en" 1
-  sysfs_write "$SE/in_anglvel_z_en" 1
+  # CHANNELS 可选：accel / anglvel / temp / steps 的任意组合，驱动只读取对应寄存器
+  local ch
+  for ch in ${CHANNELS:-accel anglvel}; do
+    case "$ch" in
+      accel|anglvel)
+        sysfs_write "$SE/in_${ch}_x_en" 1
+        sysfs_write "$SE/in_${ch}_y_en" 1
+        sysfs_write "$SE/in_${ch}_z_en" 1
+        ;;
+      temp|steps)
+        sysfs_write "$SE/in_${ch}_en" 1
+        ;;
+      *)
+        echo "[ERR] Unknown channel group: $ch" >&2
+        exit 1
+        ;;
+    esac
+  done
 
   if [[ -f "$SE/in_timestamp_en" ]]; then
     sysfs_write "$SE/in_timestamp_en" 1
@@ -133,6 +144,12 @@ set_odr_if_requested() {
   fi
 }
 
+unbind_trigger() {
+  # 不绑定 trigger 时驱动使用硬件 FIFO，watermark 即 FIFO 水位
+  echo "[INFO] Unbind trigger (hardware FIFO mode)"
+  [[ -f "$TRIG_CUR" ]] && echo "" > "$TRIG_CUR" 2>/dev/null || true
+}
+
 bind_trigger() {
   local trig
   trig="$(find_trigger_name)"
@@ -180,6 +197,8 @@ status() {
   echo -n "buffer/enable="; sysfs_read "${BUF_DIR}/enable" | tr -d '\n'; echo
   echo -n "buffer/length="; sysfs_read "${BUF_DIR}/length" | tr -d '\n'; echo
   echo -n "buffer/watermark="; sysfs_read "${BUF_DIR}/watermark" | tr -d '\n'; echo
+  echo -n "buffer/hwfifo_enabled="; sysfs_read "${BUF_DIR}/hwfifo_enabled" | tr -d '\n'; echo
+  echo -n "buffer/hwfifo_watermark="; sysfs_read "${BUF_DIR}/hwfifo_watermark" | tr -d '\n'; echo
 
   echo "=== channels enabled (scan_elements) ==="
   [[ -d "${DEV_SYS}/scan_elements" ]] && grep -H . "${DEV_SYS}/scan_elements/"*_en 2>/dev/null || true
@@ -210,11 +229,15 @@ start() {
   echo "[INFO] Disable all channels"
   disable_all_channels
 
-  echo "[INFO] Enable required channels: accel xyz + gyro xyz + timestamp"
+  echo "[INFO] Enable required channels: ${CHANNELS:-accel anglvel} + timestamp"
   enable_needed_channels
 
-  echo "[INFO] Bind trigger"
-  bind_trigger
+  if [[ "${FIFO:-0}" == "1" ]]; then
+    unbind_trigger
+  else
+    echo "[INFO] Bind trigger"
+    bind_trigger
+  fi
 
   echo "[INFO] Configure buffer (length/watermark)"
   configure_buffer
@@ -244,11 +267,14 @@ Environment variables:
   DEV_NODE=/dev/iio:device0
   ACC_HZ=100          (optional)
   GYR_HZ=200          (optional)
+  CHANNELS="accel anglvel"  (optional, any of: accel anglvel temp steps)
   BUF_LEN=256         (optional)
   BUF_WATERMARK=1     (optional)
+  FIFO=0              (optional, 1 = hardware FIFO instead of trigger)
 
 Examples:
   sudo ACC_HZ=100 GYR_HZ=200 BUF_LEN=512 BUF_WATERMARK=1 $0 start
+  sudo ACC_HZ=1600 GYR_HZ=1600 BUF_LEN=4096 BUF_WATERMARK=64 FIFO=1 $0 start
   $0 status
   sudo $0 dump 128
   sudo $0 stop
@@ -4,32 +4,223 @@
 
 #include <linux/regmap.h>
 #include <linux/mutex.h>
+#include <linux/workqueue.h>
+#include <linux/iio/iio.h>
 
 #define MPU6050_REG_SMPLRT_DIV       0x19
 #define MPU6050_REG_CONFIG           0x1A
 #define MPU6050_REG_GYRO_CONFIG      0x1B
 #define MPU6050_REG_ACCEL_CONFIG     0x1C
+#define MPU6050_REG_MOT_THR          0x1F
+#define MPU6050_REG_MOT_DUR          0x20
+#define MPU6050_REG_ZRMOT_THR        0x21
+#define MPU6050_REG_ZRMOT_DUR        0x22
+#define MPU6050_REG_FIFO_EN          0x23
+
+#define MPU6050_REG_INT_PIN_CFG      0x37
+#define MPU6050_REG_INT_ENABLE       0x38
+#define MPU6050_REG_INT_STATUS       0x3A
 
 #define MPU6050_REG_ACCEL_XOUT_H     0x3B
+#define MPU6050_REG_TEMP_OUT_H       0x41
 #define MPU6050_REG_GYRO_XOUT_H      0x43
+#define MPU6050_REG_GYRO_ZOUT_L      0x48
+#define MPU6050_REG_MOT_DETECT_STATUS 0x61
+#define MPU6050_REG_SIGNAL_PATH_RESET 0x68
 
+#define MPU6050_REG_USER_CTRL        0x6A
 #define MPU6050_REG_PWR_MGMT_1       0x6B
+#define MPU6050_REG_PWR_MGMT_2       0x6C
+#define MPU6050_REG_FIFO_COUNT_H     0x72
+#define MPU6050_REG_FIFO_R_W         0x74
 #define MPU6050_REG_WHO_AM_I         0x75
+#define MPU6050_MAX_REGISTER         MPU6050_REG_WHO_AM_I
 
 #define MPU6050_CHIP_ID              0x68
 
+/* INT_PIN_CFG: INT_LEVEL=1 -> active low; LATCH_INT_EN=0 -> 50us pulse */
+#define MPU6050_INT_LEVEL_LOW        0x80
+
+/* INT_ENABLE / INT_STATUS */
+#define MPU6050_INT_DATA_RDY         0x01
+#define MPU6050_INT_FIFO_OFLOW       0x10
+#define MPU6050_INT_ZMOT             0x20
+#define MPU6050_INT_MOT              0x40
+#define MPU6050_INT_MOTION           (MPU6050_INT_MOT | MPU6050_INT_ZMOT)
+
+/* MOT_DETECT_STATUS: set while zero motion, clear once it ended */
+#define MPU6050_MOT_ZRMOT            0x01
+
+/* ACCEL_CONFIG: ACCEL_HPF bits [2:0], feeds the motion detectors only */
+#define MPU6050_ACCEL_HPF_MASK       0x07
+#define MPU6050_ACCEL_HPF_5HZ        0x01
+
+/* Motion thresholds 2mg/LSB; MOT_DUR 1ms/LSB, ZRMOT_DUR 64ms/LSB */
+#define MPU6050_MOT_THR_MICRO        19613
+#define MPU6050_MOT_DUR_US           1000
+#define MPU6050_ZRMOT_DUR_US         64000
+
+/* FIFO_EN: frames hold the enabled outputs in data register order */
+#define MPU6050_FIFO_EN_TEMP         0x80
+#define MPU6050_FIFO_EN_GYRO         0x70
+#define MPU6050_FIFO_EN_ACCEL        0x08
+
+/* USER_CTRL */
+#define MPU6050_USER_CTRL_FIFO_EN    0x40
+#define MPU6050_USER_CTRL_I2C_IF_DIS 0x10
+#define MPU6050_USER_CTRL_FIFO_RESET 0x04
+
+/* PWR_MGMT_1 */
+#define MPU6050_PWR1_SLEEP           0x40
+#define MPU6050_PWR1_CYCLE           0x20
+#define MPU6050_PWR1_TEMP_DIS        0x08
+#define MPU6050_CLKSEL_INTERNAL      0x00
+#define MPU6050_CLKSEL_PLL_XGYRO     0x01
+
+/* PWR_MGMT_2: LP_WAKE_CTRL bits [7:6], accel and gyro standby per axis */
+#define MPU6050_LP_WAKE_SHIFT        6
+#define MPU6050_STBY_ACCEL           0x38
+#define MPU6050_STBY_GYRO            0x07
+
+/* Gyro start-up from standby or sleep, typical */
+#define MPU6050_GYRO_STARTUP_MS      30
+#define MPU6050_AUTOSUSPEND_DELAY_MS 2000
+
+#define MPU6050_FIFO_SIZE            1024
+
+/* ACCEL_XOUT_H .. GYRO_ZOUT_L: accel xyz, temp, gyro xyz */
+#define MPU6050_DATA_BURST_LEN       14
+/* ACCEL_XOUT_H .. TEMP_OUT_L, and GYRO_XOUT_H .. GYRO_ZOUT_L */
+#define MPU6050_ACCEL_TEMP_LEN       8
+#define MPU6050_GYRO_LEN             6
+/* MPU6050_FIFO_SIZE / MPU6050_GYRO_LEN, the shortest frame */
+#define MPU6050_FIFO_MAX_FRAMES      170
+/*
+ * Half the FIFO: the other half absorbs the drain work running late, so
+ * a late drain does not end in an overflow reset
+ */
+#define MPU6050_FIFO_WATERMARK_MAX   36
+
 /* FS_SEL bits [4:3] */
 #define MPU6050_FS_SEL_MASK          0x18
 #define MPU6050_FS_SEL_SHIFT         3
 
-/* We configure DLPF_CFG=3 -> base sample rate assumed 1kHz */
+/* CONFIG: DLPF_CFG bits [2:0], 0 disables the filter, 7 is reserved */
+#define MPU6050_DLPF_CFG_MASK        0x07
+#define MPU6050_DLPF_CFG_OFF         0
+#define MPU6050_DLPF_CFG_NUM         7
+/* 44 Hz accel, 42 Hz gyro */
+#define MPU6050_DLPF_CFG_DEFAULT     3
+
+/* Gyro output rate SMPLRT_DIV divides: 8kHz with DLPF off, 1kHz otherwise */
 #define MPU6050_BASE_RATE_HZ         1000
+#define MPU6050_BASE_RATE_FAST_HZ    8000
+
+enum mpu6050_scan {
+	MPU6050_SCAN_ACCEL_X,
+	MPU6050_SCAN_ACCEL_Y,
+	MPU6050_SCAN_ACCEL_Z,
+	MPU6050_SCAN_TEMP,
+	MPU6050_SCAN_GYRO_X,
+	MPU6050_SCAN_GYRO_Y,
+	MPU6050_SCAN_GYRO_Z,
+	MPU6050_SCAN_TIMESTAMP,
+};
+
+/*
+ * Power users: streaming accel (also keeps the temperature sensor up),
+ * gyro, and accel for the motion detectors only, which may run in
+ * LP_WAKE cycle mode.
+ */
+enum mpu6050_pwr_block {
+	MPU6050_PWR_ACCEL,
+	MPU6050_PWR_GYRO,
+	MPU6050_PWR_MOTION,
+	MPU6050_PWR_BLOCKS,
+};
 
 struct mpu6050_data {
+	struct device *dev;
+	struct iio_dev *indio_dev;
 	struct regmap *regmap;
 	struct mutex lock;
+
+	/*
+	 * Copies of FS_SEL, DLPF_CFG and SMPLRT_DIV, written under 'lock'
+	 * together with the registers, read locklessly.
+	 */
+	unsigned int accel_fs;
+	unsigned int gyro_fs;
+	unsigned int dlpf_cfg;
+	unsigned int smplrt_div;
+	struct iio_trigger *trig;
+	bool drdy_enabled;
+
+	/* Users per block; blocks raw reads woke, held until raw_work */
+	unsigned int pwr_refs[MPU6050_PWR_BLOCKS];
+	unsigned long raw_blocks;
+	struct delayed_work raw_work;
+	/* Index into the lp_wake_frequency items, 0 keeps cycle mode off */
+	unsigned int lp_wake;
+
+	/* INT_ENABLE motion bits, and status bits read but not yet handled */
+	unsigned int events;
+	unsigned int int_status;
+
+	/* FIFO mode: drained every 'watermark' sample periods */
+	struct delayed_work fifo_work;
+	unsigned int watermark;
+	bool fifo_enabled;
+	s64 fifo_period_ns;
+
+	/* Taken from active_scan_mask when the buffer is enabled */
+	unsigned long buffer_blocks;
+	unsigned int frame_reg;
+	unsigned int frame_len;
+	unsigned int fifo_en;
+
+	/*
+	 * One frame of the buffered sensors, laid out as the registers are
+	 * so that it is pushed as is. DMA-safe for the bus read.
+	 */
+	struct {
+		__be16 channels[MPU6050_SCAN_TIMESTAMP];
+		aligned_s64 timestamp;
+	} scan __aligned(IIO_DMA_MINALIGN);
+
+	/* Raw reads; in snapshot mode a whole frame taken at frame_ts */
+	bool snapshot;
+	s64 frame_ts;
+	__be16 frame[MPU6050_SCAN_TIMESTAMP] __aligned(IIO_DMA_MINALIGN);
+
+	__be16 fifo_count __aligned(IIO_DMA_MINALIGN);
+	u8 fifo_buf[MPU6050_FIFO_SIZE] __aligned(IIO_DMA_MINALIGN);
 };
 
-int mpu6050_core_probe(struct device *dev, struct regmap *regmap);
+/*
+ * MPU6000 SPI: registers are only specified up to 1MHz, but the sensor
+ * data and interrupt registers may be read at up to 20MHz. Each transfer
+ * picks its clock from the registers it touches; spi-max-frequency in DT
+ * still caps both. The KUnit bus model times SPI transfers with it too.
+ */
+#define MPU6050_SPI_READ             0x80
+#define MPU6050_SPI_CONF_HZ          1000000
+#define MPU6050_SPI_DATA_HZ          20000000
+
+static inline u32 mpu6050_spi_speed(unsigned int reg, size_t len)
+{
+	if (reg >= MPU6050_REG_INT_STATUS &&
+	    reg + len - 1 <= MPU6050_REG_GYRO_ZOUT_L)
+		return MPU6050_SPI_DATA_HZ;
+
+	return MPU6050_SPI_CONF_HZ;
+}
+
+extern const struct regmap_access_table mpu6050_volatile_table;
+extern const struct regmap_access_table mpu6050_precious_table;
+
+extern const struct dev_pm_ops mpu6050_core_pm_ops;
+
+int mpu6050_core_probe(struct device *dev, struct regmap *regmap, int irq);
 
 #endif
\ No newline at end of file
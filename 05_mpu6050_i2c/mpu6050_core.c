@@ -1,10 +1,23 @@
 // SPDX-License-Identifier: GPL-2.0
 #include <linux/module.h>
+#include <linux/delay.h>
+#include <linux/interrupt.h>
+#include <linux/irq.h>
 #include <linux/iio/iio.h>
+#include <linux/iio/buffer.h>
+#include <linux/iio/events.h>
 #include <linux/iio/sysfs.h>
+#include <linux/iio/trigger.h>
+#include <linux/iio/trigger_consumer.h>
+#include <linux/iio/triggered_buffer.h>
 #include <linux/mutex.h>
 #include <linux/regmap.h>
 #include <linux/kernel.h>
+#include <linux/math64.h>
+#include <linux/pm_runtime.h>
+#include <linux/timekeeping.h>
+#include <linux/units.h>
+#include <linux/workqueue.h>
 #include "mpu6050.h"
 
 struct mpu6050_scale {
@@ -42,67 +55,95 @@ static const struct mpu6050_scale gyro_scales[] = {
 	{ 0, 1065 },  /* ±2000 dps */
 };
 
-/* Keep it simple: only divisors of 1000Hz (base rate) */
-static const int sampling_freqs[] = { 10, 20, 25, 50, 100, 200, 250, 500, 1000 };
+/*
+ * temperature in degC = raw / 340 + 36.53
+ * IIO: (raw + offset) * scale in milli degC
+ * scale  = 1000 / 340     = 2.941176
+ * offset = 36.53 * 340    = 12420.2
+ */
+#define MPU6050_TEMP_SCALE_VAL       2
+#define MPU6050_TEMP_SCALE_VAL2      941176
+#define MPU6050_TEMP_OFFSET_VAL      12420
+#define MPU6050_TEMP_OFFSET_VAL2     200000
+
+/* 3dB bandwidth in Hz, indexed by DLPF_CFG; accel and gyro differ slightly */
+static const int accel_3db_hz[MPU6050_DLPF_CFG_NUM] = {
+	260, 184, 94, 44, 21, 10, 5,
+};
 
-static int mpu6050_read_u16be(struct mpu6050_data *data, int reg, int *out)
-{
-	unsigned int hi, lo;
-	int ret;
+static const int gyro_3db_hz[MPU6050_DLPF_CFG_NUM] = {
+	256, 188, 98, 42, 20, 10, 5,
+};
 
-	ret = regmap_read(data->regmap, reg, &hi);
-	if (ret)
-		return ret;
+/*
+ * Whole-Hz rates base/(1+div) for div 0..255, one list per base rate.
+ * Any rate in between is accepted and snapped to the nearest divider.
+ */
+static const int samp_freq_avail[] = {
+	4, 5, 8, 10, 20, 25, 40, 50, 100, 125, 200, 250, 500, 1000,
+};
 
-	ret = regmap_read(data->regmap, reg + 1, &lo);
-	if (ret)
-		return ret;
+static const int samp_freq_fast_avail[] = {
+	32, 40, 50, 64, 80, 100, 125, 160, 200, 250, 320, 400, 500, 800,
+	1000, 1600, 2000, 4000, 8000,
+};
 
-	*out = (s16)((hi << 8) | lo);
-	return 0;
-}
+/*
+ * Volatile: status, sample data, FIFO and the registers with self-clearing
+ * reset bits. Everything else is configuration only the driver writes.
+ */
+static const struct regmap_range mpu6050_volatile_ranges[] = {
+	regmap_reg_range(MPU6050_REG_INT_STATUS, MPU6050_REG_MOT_DETECT_STATUS),
+	regmap_reg_range(MPU6050_REG_SIGNAL_PATH_RESET,
+			 MPU6050_REG_SIGNAL_PATH_RESET),
+	regmap_reg_range(MPU6050_REG_USER_CTRL, MPU6050_REG_USER_CTRL),
+	regmap_reg_range(MPU6050_REG_FIFO_COUNT_H, MPU6050_REG_FIFO_R_W),
+};
+
+const struct regmap_access_table mpu6050_volatile_table = {
+	.yes_ranges = mpu6050_volatile_ranges,
+	.n_yes_ranges = ARRAY_SIZE(mpu6050_volatile_ranges),
+};
+EXPORT_SYMBOL_GPL(mpu6050_volatile_table);
+
+/* Reading these has side effects, never read them speculatively */
+static const struct regmap_range mpu6050_precious_ranges[] = {
+	regmap_reg_range(MPU6050_REG_INT_STATUS, MPU6050_REG_INT_STATUS),
+	regmap_reg_range(MPU6050_REG_FIFO_R_W, MPU6050_REG_FIFO_R_W),
+};
+
+const struct regmap_access_table mpu6050_precious_table = {
+	.yes_ranges = mpu6050_precious_ranges,
+	.n_yes_ranges = ARRAY_SIZE(mpu6050_precious_ranges),
+};
+EXPORT_SYMBOL_GPL(mpu6050_precious_table);
 
+/* Served from the decoded copy, no bus access and no lock */
 static int mpu6050_get_scale(struct mpu6050_data *data, int chan_type,
 			     int *val, int *val2)
 {
-	unsigned int regval;
 	unsigned int idx;
-	int ret, reg;
 
 	switch (chan_type) {
 	case IIO_ACCEL:
-		reg = MPU6050_REG_ACCEL_CONFIG;
-		break;
-	case IIO_ANGL_VEL:
-		reg = MPU6050_REG_GYRO_CONFIG;
-		break;
-	default:
-		return -EINVAL;
-	}
-
-	ret = regmap_read(data->regmap, reg, &regval);
-	if (ret)
-		return ret;
-
-	idx = (regval & MPU6050_FS_SEL_MASK) >> MPU6050_FS_SEL_SHIFT;
-	if (idx > 3)
-		return -EINVAL;
-
-	if (chan_type == IIO_ACCEL) {
+		idx = READ_ONCE(data->accel_fs);
 		*val = accel_scales[idx].val;
 		*val2 = accel_scales[idx].val2;
-	} else {
+		return 0;
+	case IIO_ANGL_VEL:
+		idx = READ_ONCE(data->gyro_fs);
 		*val = gyro_scales[idx].val;
 		*val2 = gyro_scales[idx].val2;
+		return 0;
+	default:
+		return -EINVAL;
 	}
-
-	return 0;
 }
 
 static int mpu6050_set_scale(struct mpu6050_data *data, int chan_type,
 			     int val, int val2)
 {
-	int i, reg;
+	int i, reg, ret;
 	unsigned int bits;
 
 	if (val != 0)
@@ -135,40 +176,332 @@ static int mpu6050_set_scale(struct mpu6050_data *data, int chan_type,
 		return -EINVAL;
 	}
 
+	/* A snapshot taken at the old range must not be reused */
+	data->frame_ts = 0;
+
 	bits = (unsigned int)i << MPU6050_FS_SEL_SHIFT;
-	return regmap_update_bits(data->regmap, reg, MPU6050_FS_SEL_MASK, bits);
+	ret = regmap_update_bits(data->regmap, reg, MPU6050_FS_SEL_MASK, bits);
+	if (ret)
+		return ret;
+
+	if (chan_type == IIO_ACCEL)
+		WRITE_ONCE(data->accel_fs, i);
+	else
+		WRITE_ONCE(data->gyro_fs, i);
+
+	return 0;
+}
+
+static unsigned int mpu6050_base_rate_hz(unsigned int dlpf_cfg)
+{
+	if (dlpf_cfg == MPU6050_DLPF_CFG_OFF)
+		return MPU6050_BASE_RATE_FAST_HZ;
+
+	return MPU6050_BASE_RATE_HZ;
+}
+
+/* sample_rate = base/(1+div) */
+static s64 mpu6050_samp_period_ns(struct mpu6050_data *data)
+{
+	unsigned int base = mpu6050_base_rate_hz(READ_ONCE(data->dlpf_cfg));
+
+	return div_u64((u64)(READ_ONCE(data->smplrt_div) + 1) * NSEC_PER_SEC,
+		       base);
+}
+
+static void mpu6050_get_samp_freq(struct mpu6050_data *data,
+				  int *val, int *val2)
+{
+	unsigned int base = mpu6050_base_rate_hz(READ_ONCE(data->dlpf_cfg));
+	u64 uhz;
+	u32 rem;
+
+	uhz = div_u64((u64)base * MICROHZ_PER_HZ,
+		      READ_ONCE(data->smplrt_div) + 1);
+	*val = div_u64_rem(uhz, MICROHZ_PER_HZ, &rem);
+	*val2 = rem;
 }
 
-static int mpu6050_get_samp_freq(struct mpu6050_data *data, int *hz)
+/* Snap to the nearest rate the divider can make, called with data->lock held */
+static int mpu6050_set_samp_freq(struct mpu6050_data *data, int val, int val2)
 {
-	unsigned int div;
+	unsigned int base = mpu6050_base_rate_hz(data->dlpf_cfg);
+	u64 uhz, div;
 	int ret;
 
-	ret = regmap_read(data->regmap, MPU6050_REG_SMPLRT_DIV, &div);
+	if (val < 0 || val2 < 0 || (!val && !val2))
+		return -EINVAL;
+
+	uhz = (u64)val * MICROHZ_PER_HZ + val2;
+	div = DIV64_U64_ROUND_CLOSEST((u64)base * MICROHZ_PER_HZ, uhz);
+	div = clamp_t(u64, div, 1, 256) - 1;
+
+	data->frame_ts = 0;
+
+	ret = regmap_write(data->regmap, MPU6050_REG_SMPLRT_DIV, div);
 	if (ret)
 		return ret;
 
-	/* sample_rate = base/(1+div) */
-	*hz = MPU6050_BASE_RATE_HZ / (1 + (div & 0xFF));
+	WRITE_ONCE(data->smplrt_div, div);
 	return 0;
 }
 
-static int mpu6050_set_samp_freq(struct mpu6050_data *data, int hz)
+static int mpu6050_get_filter_3db(struct mpu6050_data *data, int chan_type,
+				  int *val)
 {
-	int div;
+	unsigned int cfg = READ_ONCE(data->dlpf_cfg);
 
-	if (hz <= 0 || hz > MPU6050_BASE_RATE_HZ)
+	switch (chan_type) {
+	case IIO_ACCEL:
+		*val = accel_3db_hz[cfg];
+		return 0;
+	case IIO_ANGL_VEL:
+		*val = gyro_3db_hz[cfg];
+		return 0;
+	default:
 		return -EINVAL;
+	}
+}
 
-	/* Require exact divisor for simplicity */
-	if (MPU6050_BASE_RATE_HZ % hz)
+/*
+ * The filter is shared by accel and gyro, either table selects it. The
+ * sample rate is kept, as far as the new base rate allows.
+ */
+static int mpu6050_set_filter_3db(struct mpu6050_data *data, int chan_type,
+				  int val)
+{
+	const int *tbl;
+	int i, ret, hz, micro;
+
+	switch (chan_type) {
+	case IIO_ACCEL:
+		tbl = accel_3db_hz;
+		break;
+	case IIO_ANGL_VEL:
+		tbl = gyro_3db_hz;
+		break;
+	default:
 		return -EINVAL;
+	}
 
-	div = (MPU6050_BASE_RATE_HZ / hz) - 1;
-	if (div < 0 || div > 255)
+	for (i = 0; i < MPU6050_DLPF_CFG_NUM; i++) {
+		if (tbl[i] == val)
+			break;
+	}
+	if (i == MPU6050_DLPF_CFG_NUM)
 		return -EINVAL;
 
-	return regmap_write(data->regmap, MPU6050_REG_SMPLRT_DIV, div);
+	mpu6050_get_samp_freq(data, &hz, &micro);
+
+	data->frame_ts = 0;
+
+	ret = regmap_update_bits(data->regmap, MPU6050_REG_CONFIG,
+				 MPU6050_DLPF_CFG_MASK, i);
+	if (ret)
+		return ret;
+
+	WRITE_ONCE(data->dlpf_cfg, i);
+	return mpu6050_set_samp_freq(data, hz, micro);
+}
+
+static int mpu6050_pm_get(struct mpu6050_data *data)
+{
+	return pm_runtime_resume_and_get(data->dev);
+}
+
+static void mpu6050_pm_put(struct mpu6050_data *data)
+{
+	pm_runtime_mark_last_busy(data->dev);
+	pm_runtime_put_autosuspend(data->dev);
+}
+
+/*
+ * Program PWR_MGMT_1/2 for the current users. Blocks without one go to
+ * standby, and accel used only by the motion detectors cycles at the
+ * LP_WAKE rate if one is set. The PLL runs off the gyro, so the internal
+ * oscillator takes over while the gyro is in standby.
+ */
+static int mpu6050_power_apply(struct mpu6050_data *data)
+{
+	bool accel = data->pwr_refs[MPU6050_PWR_ACCEL];
+	bool gyro = data->pwr_refs[MPU6050_PWR_GYRO];
+	bool motion = data->pwr_refs[MPU6050_PWR_MOTION];
+	unsigned int pwr1, pwr2 = 0;
+	int ret;
+
+	pwr1 = gyro ? MPU6050_CLKSEL_PLL_XGYRO : MPU6050_CLKSEL_INTERNAL;
+	if (!gyro)
+		pwr2 |= MPU6050_STBY_GYRO;
+	if (!accel && !motion)
+		pwr2 |= MPU6050_STBY_ACCEL;
+
+	if (motion && !accel && !gyro && data->lp_wake) {
+		pwr1 |= MPU6050_PWR1_CYCLE | MPU6050_PWR1_TEMP_DIS;
+		pwr2 |= (data->lp_wake - 1) << MPU6050_LP_WAKE_SHIFT;
+	}
+
+	/* Gyro up before the PLL locks to it, down after switching away */
+	if (gyro) {
+		ret = regmap_write(data->regmap, MPU6050_REG_PWR_MGMT_2, pwr2);
+		if (ret)
+			return ret;
+
+		return regmap_write(data->regmap, MPU6050_REG_PWR_MGMT_1, pwr1);
+	}
+
+	ret = regmap_write(data->regmap, MPU6050_REG_PWR_MGMT_1, pwr1);
+	if (ret)
+		return ret;
+
+	return regmap_write(data->regmap, MPU6050_REG_PWR_MGMT_2, pwr2);
+}
+
+/* Sleep until blocks that just came up deliver valid samples */
+static void mpu6050_power_wait(struct mpu6050_data *data, unsigned long blocks)
+{
+	unsigned long us = 0;
+
+	if (blocks & BIT(MPU6050_PWR_GYRO))
+		us = MPU6050_GYRO_STARTUP_MS * USEC_PER_MSEC;
+
+	/* Accel needs no start-up, only the next sample */
+	if (blocks & BIT(MPU6050_PWR_ACCEL))
+		us = max_t(unsigned long, us,
+			   div_u64(mpu6050_samp_period_ns(data),
+				   NSEC_PER_USEC));
+
+	if (us)
+		fsleep(us);
+}
+
+static int mpu6050_power_get(struct mpu6050_data *data, unsigned long blocks)
+{
+	unsigned long woken = 0;
+	unsigned int b;
+	int ret;
+
+	lockdep_assert_held(&data->lock);
+
+	for_each_set_bit(b, &blocks, MPU6050_PWR_BLOCKS)
+		if (!data->pwr_refs[b]++)
+			woken |= BIT(b);
+
+	if (!woken)
+		return 0;
+
+	ret = mpu6050_power_apply(data);
+	if (ret) {
+		for_each_set_bit(b, &blocks, MPU6050_PWR_BLOCKS)
+			data->pwr_refs[b]--;
+		return ret;
+	}
+
+	mpu6050_power_wait(data, woken);
+	return 0;
+}
+
+static int mpu6050_power_put(struct mpu6050_data *data, unsigned long blocks)
+{
+	bool changed = false;
+	unsigned int b;
+
+	lockdep_assert_held(&data->lock);
+
+	for_each_set_bit(b, &blocks, MPU6050_PWR_BLOCKS)
+		if (!--data->pwr_refs[b])
+			changed = true;
+
+	return changed ? mpu6050_power_apply(data) : 0;
+}
+
+/* Called with data->lock held */
+static void mpu6050_raw_power_put(struct mpu6050_data *data)
+{
+	mpu6050_power_put(data, data->raw_blocks);
+	data->raw_blocks = 0;
+}
+
+static void mpu6050_raw_work(struct work_struct *work)
+{
+	struct mpu6050_data *data = container_of(work, struct mpu6050_data,
+						 raw_work.work);
+
+	mutex_lock(&data->lock);
+	mpu6050_raw_power_put(data);
+	mutex_unlock(&data->lock);
+}
+
+/*
+ * Raw reads keep their sensor up for as long as the autosuspend delay
+ * after the last read, instead of paying the start-up time on every
+ * read. A snapshot covers both sensors.
+ */
+static int mpu6050_raw_power_get(struct mpu6050_data *data, int chan_type)
+{
+	unsigned long blocks;
+	int ret;
+
+	if (data->snapshot)
+		blocks = BIT(MPU6050_PWR_ACCEL) | BIT(MPU6050_PWR_GYRO);
+	else if (chan_type == IIO_ANGL_VEL)
+		blocks = BIT(MPU6050_PWR_GYRO);
+	else
+		blocks = BIT(MPU6050_PWR_ACCEL);
+
+	blocks &= ~data->raw_blocks;
+	if (blocks) {
+		ret = mpu6050_power_get(data, blocks);
+		if (ret)
+			return ret;
+
+		data->raw_blocks |= blocks;
+	}
+
+	mod_delayed_work(system_wq, &data->raw_work,
+			 msecs_to_jiffies(MPU6050_AUTOSUSPEND_DELAY_MS));
+	return 0;
+}
+
+static void mpu6050_cancel_raw_work(void *context)
+{
+	struct mpu6050_data *data = context;
+
+	cancel_delayed_work_sync(&data->raw_work);
+}
+
+/*
+ * Read one data register pair in a single transfer, so that a sample
+ * update between high and low byte cannot tear it. In snapshot mode the
+ * whole 14-byte frame is read instead, and the other channels are served
+ * from it until the next sample is due, so that a set of raw reads comes
+ * from one sample. Called with data->lock held.
+ */
+static int mpu6050_read_channel(struct mpu6050_data *data, int idx, int *val)
+{
+	s64 now = ktime_get_ns();
+	int ret;
+
+	if (data->snapshot) {
+		if (now - data->frame_ts >= mpu6050_samp_period_ns(data)) {
+			ret = regmap_bulk_read(data->regmap,
+					       MPU6050_REG_ACCEL_XOUT_H,
+					       data->frame,
+					       MPU6050_DATA_BURST_LEN);
+			if (ret)
+				return ret;
+
+			data->frame_ts = now;
+		}
+	} else {
+		ret = regmap_bulk_read(data->regmap,
+				       MPU6050_REG_ACCEL_XOUT_H + 2 * idx,
+				       &data->frame[idx], sizeof(__be16));
+		if (ret)
+			return ret;
+	}
+
+	*val = (s16)be16_to_cpu(data->frame[idx]);
+	return 0;
 }
 
 static int mpu6050_read_raw(struct iio_dev *indio_dev,
@@ -176,7 +509,7 @@ static int mpu6050_read_raw(struct iio_dev *indio_dev,
 			    int *val, int *val2, long mask)
 {
 	struct mpu6050_data *data = iio_priv(indio_dev);
-	int reg, ret, tmp;
+	int ret, tmp;
 
 	switch (mask) {
 	case IIO_CHAN_INFO_RAW:
@@ -184,30 +517,21 @@ static int mpu6050_read_raw(struct iio_dev *indio_dev,
 		if (ret)
 			return ret;
 
-		mutex_lock(&data->lock);
-
-		if (chan->type == IIO_ACCEL)
-			reg = MPU6050_REG_ACCEL_XOUT_H;
-		else if (chan->type == IIO_ANGL_VEL)
-			reg = MPU6050_REG_GYRO_XOUT_H;
-		else {
-			mutex_unlock(&data->lock);
-			iio_device_release_direct_mode(indio_dev);
-			return -EINVAL;
-		}
-
-		switch (chan->channel2) {
-		case IIO_MOD_X: reg += 0; break;
-		case IIO_MOD_Y: reg += 2; break;
-		case IIO_MOD_Z: reg += 4; break;
-		default:
-			mutex_unlock(&data->lock);
+		ret = mpu6050_pm_get(data);
+		if (ret) {
 			iio_device_release_direct_mode(indio_dev);
-			return -EINVAL;
+			return ret;
 		}
 
-		ret = mpu6050_read_u16be(data, reg, &tmp);
+		/* scan_index follows the register layout */
+		mutex_lock(&data->lock);
+		ret = mpu6050_raw_power_get(data, chan->type);
+		if (!ret)
+			ret = mpu6050_read_channel(data, chan->scan_index,
+						   &tmp);
 		mutex_unlock(&data->lock);
+
+		mpu6050_pm_put(data);
 		iio_device_release_direct_mode(indio_dev);
 		if (ret)
 			return ret;
@@ -216,24 +540,35 @@ static int mpu6050_read_raw(struct iio_dev *indio_dev,
 		return IIO_VAL_INT;
 
 	case IIO_CHAN_INFO_SCALE:
-		mutex_lock(&data->lock);
+		if (chan->type == IIO_TEMP) {
+			*val = MPU6050_TEMP_SCALE_VAL;
+			*val2 = MPU6050_TEMP_SCALE_VAL2;
+			return IIO_VAL_INT_PLUS_MICRO;
+		}
+
 		ret = mpu6050_get_scale(data, chan->type, val, val2);
-		mutex_unlock(&data->lock);
 		if (ret)
 			return ret;
 		return IIO_VAL_INT_PLUS_MICRO;
 
 	case IIO_CHAN_INFO_SAMP_FREQ:
-		mutex_lock(&data->lock);
-		ret = mpu6050_get_samp_freq(data, &tmp);
-		mutex_unlock(&data->lock);
+		mpu6050_get_samp_freq(data, val, val2);
+		return IIO_VAL_INT_PLUS_MICRO;
+
+	case IIO_CHAN_INFO_LOW_PASS_FILTER_3DB_FREQUENCY:
+		ret = mpu6050_get_filter_3db(data, chan->type, val);
 		if (ret)
 			return ret;
-
-		*val = tmp;
-		*val2 = 0;
 		return IIO_VAL_INT;
 
+	case IIO_CHAN_INFO_OFFSET:
+		if (chan->type != IIO_TEMP)
+			return -EINVAL;
+
+		*val = MPU6050_TEMP_OFFSET_VAL;
+		*val2 = MPU6050_TEMP_OFFSET_VAL2;
+		return IIO_VAL_INT_PLUS_MICRO;
+
 	default:
 		return -EINVAL;
 	}
@@ -260,7 +595,19 @@ static int mpu6050_write_raw(struct iio_dev *indio_dev,
 		return ret;
 
 	case IIO_CHAN_INFO_SAMP_FREQ:
-		/* sysfs 里一般只写整数 Hz，val2 应为 0 */
+		/* 可写小数 Hz，取最接近的可实现分频 */
+		ret = iio_device_claim_direct_mode(indio_dev);
+		if (ret)
+			return ret;
+
+		mutex_lock(&data->lock);
+		ret = mpu6050_set_samp_freq(data, val, val2);
+		mutex_unlock(&data->lock);
+
+		iio_device_release_direct_mode(indio_dev);
+		return ret;
+
+	case IIO_CHAN_INFO_LOW_PASS_FILTER_3DB_FREQUENCY:
 		if (val2 != 0)
 			return -EINVAL;
 
@@ -269,7 +616,7 @@ static int mpu6050_write_raw(struct iio_dev *indio_dev,
 			return ret;
 
 		mutex_lock(&data->lock);
-		ret = mpu6050_set_samp_freq(data, val);
+		ret = mpu6050_set_filter_3db(data, chan->type, val);
 		mutex_unlock(&data->lock);
 
 		iio_device_release_direct_mode(indio_dev);
@@ -285,6 +632,8 @@ static int mpu6050_read_avail(struct iio_dev *indio_dev,
 			      const int **vals, int *type,
 			      int *length, long mask)
 {
+	struct mpu6050_data *data = iio_priv(indio_dev);
+
 	switch (mask) {
 	case IIO_CHAN_INFO_SCALE:
 		*type = IIO_VAL_INT_PLUS_MICRO;
@@ -305,58 +654,890 @@ static int mpu6050_read_avail(struct iio_dev *indio_dev,
 
 	case IIO_CHAN_INFO_SAMP_FREQ:
 		*type = IIO_VAL_INT;
-		*vals = sampling_freqs;
-		*length = ARRAY_SIZE(sampling_freqs);
+		if (READ_ONCE(data->dlpf_cfg) == MPU6050_DLPF_CFG_OFF) {
+			*vals = samp_freq_fast_avail;
+			*length = ARRAY_SIZE(samp_freq_fast_avail);
+		} else {
+			*vals = samp_freq_avail;
+			*length = ARRAY_SIZE(samp_freq_avail);
+		}
 		return IIO_AVAIL_LIST;
 
+	case IIO_CHAN_INFO_LOW_PASS_FILTER_3DB_FREQUENCY:
+		*type = IIO_VAL_INT;
+		*length = MPU6050_DLPF_CFG_NUM;
+
+		if (chan->type == IIO_ACCEL) {
+			*vals = accel_3db_hz;
+			return IIO_AVAIL_LIST;
+		}
+
+		if (chan->type == IIO_ANGL_VEL) {
+			*vals = gyro_3db_hz;
+			return IIO_AVAIL_LIST;
+		}
+
+		return -EINVAL;
+
 	default:
 		return -EINVAL;
 	}
 }
 
-static const struct iio_info mpu6050_info = {
-	.read_raw   = mpu6050_read_raw,
-	.write_raw  = mpu6050_write_raw,
-	.read_avail = mpu6050_read_avail,
-};
+/* Drop whatever is queued and start over, called with data->lock held */
+static int mpu6050_fifo_reset(struct mpu6050_data *data)
+{
+	int ret;
 
-#define MPU6050_ACCEL_CHANNEL(_axis) {					\
-	.type = IIO_ACCEL,						\
-	.modified = 1,							\
-	.channel2 = IIO_MOD_##_axis,					\
-	.info_mask_separate = BIT(IIO_CHAN_INFO_RAW),			\
-	.info_mask_shared_by_type = BIT(IIO_CHAN_INFO_SCALE) |		\
-		BIT(IIO_CHAN_INFO_SAMP_FREQ),				\
-	.info_mask_shared_by_type_available = BIT(IIO_CHAN_INFO_SCALE) | \
-		BIT(IIO_CHAN_INFO_SAMP_FREQ),				\
-}
+	ret = regmap_update_bits(data->regmap, MPU6050_REG_USER_CTRL,
+				 MPU6050_USER_CTRL_FIFO_EN, 0);
+	if (ret)
+		return ret;
 
-#define MPU6050_GYRO_CHANNEL(_axis) {					\
-	.type = IIO_ANGL_VEL,						\
-	.modified = 1,							\
-	.channel2 = IIO_MOD_##_axis,					\
-	.info_mask_separate = BIT(IIO_CHAN_INFO_RAW),			\
-	.info_mask_shared_by_type = BIT(IIO_CHAN_INFO_SCALE) |		\
-		BIT(IIO_CHAN_INFO_SAMP_FREQ),				\
-	.info_mask_shared_by_type_available = BIT(IIO_CHAN_INFO_SCALE) | \
-		BIT(IIO_CHAN_INFO_SAMP_FREQ),				\
+	ret = regmap_update_bits(data->regmap, MPU6050_REG_USER_CTRL,
+				 MPU6050_USER_CTRL_FIFO_RESET,
+				 MPU6050_USER_CTRL_FIFO_RESET);
+	if (ret)
+		return ret;
+
+	return regmap_update_bits(data->regmap, MPU6050_REG_USER_CTRL,
+				  MPU6050_USER_CTRL_FIFO_EN,
+				  MPU6050_USER_CTRL_FIFO_EN);
 }
 
-static const struct iio_chan_spec mpu6050_channels[] = {
-	MPU6050_ACCEL_CHANNEL(X),
+/*
+ * Read and so clear INT_STATUS, reporting the motion interrupts it holds
+ * and keeping the other bits for their users. Everything reading
+ * INT_STATUS must go through here or events get lost. Called with
+ * data->lock held.
+ */
+static int mpu6050_read_int_status(struct iio_dev *indio_dev)
+{
+	struct mpu6050_data *data = iio_priv(indio_dev);
+	unsigned int status, mot;
+	s64 timestamp;
+	int ret;
+
+	ret = regmap_read(data->regmap, MPU6050_REG_INT_STATUS, &status);
+	if (ret)
+		return ret;
+
+	data->int_status |= status & ~MPU6050_INT_MOTION;
+
+	status &= data->events;
+	if (!status)
+		return 0;
+
+	timestamp = iio_get_time_ns(indio_dev);
+
+	if (status & MPU6050_INT_MOT)
+		iio_push_event(indio_dev, IIO_MOD_EVENT_CODE(IIO_ACCEL, 0,
+							     IIO_MOD_X_OR_Y_OR_Z,
+							     IIO_EV_TYPE_MAG_ADAPTIVE,
+							     IIO_EV_DIR_RISING),
+			       timestamp);
+
+	/* Raised both when zero motion starts and when it ends */
+	if (status & MPU6050_INT_ZMOT) {
+		ret = regmap_read(data->regmap, MPU6050_REG_MOT_DETECT_STATUS,
+				  &mot);
+		if (ret)
+			return ret;
+
+		iio_push_event(indio_dev, IIO_MOD_EVENT_CODE(IIO_ACCEL, 0,
+							     IIO_MOD_X_AND_Y_AND_Z,
+							     IIO_EV_TYPE_ROC,
+							     (mot & MPU6050_MOT_ZRMOT) ?
+							     IIO_EV_DIR_RISING :
+							     IIO_EV_DIR_FALLING),
+			       timestamp);
+	}
+
+	return 0;
+}
+
+/*
+ * Push up to @max whole frames from the FIFO in one burst. The newest frame
+ * in the FIFO is stamped with the drain time, older ones one sample period
+ * apart, also when frames newer than the pushed ones stay queued.
+ * Returns the number of frames pushed. Called with data->lock held.
+ */
+static int mpu6050_fifo_drain(struct iio_dev *indio_dev, unsigned int max)
+{
+	struct mpu6050_data *data = iio_priv(indio_dev);
+	unsigned int status, count, total, n, i;
+	s64 now;
+	int ret;
+
+	ret = mpu6050_read_int_status(indio_dev);
+	if (ret)
+		return ret;
+
+	status = data->int_status;
+	data->int_status &= ~MPU6050_INT_FIFO_OFLOW;
+
+	ret = regmap_bulk_read(data->regmap, MPU6050_REG_FIFO_COUNT_H,
+			       &data->fifo_count, sizeof(data->fifo_count));
+	if (ret)
+		return ret;
+
+	now = iio_get_time_ns(indio_dev);
+	count = be16_to_cpu(data->fifo_count);
+
+	/* Once full, frames may have been cut and we lost track of them */
+	if ((status & MPU6050_INT_FIFO_OFLOW) || count >= MPU6050_FIFO_SIZE) {
+		dev_warn_ratelimited(regmap_get_device(data->regmap),
+				     "FIFO overflow, resetting\n");
+		return mpu6050_fifo_reset(data);
+	}
+
+	total = count / data->frame_len;
+	n = min(total, max);
+	if (!n)
+		return 0;
+
+	ret = regmap_noinc_read(data->regmap, MPU6050_REG_FIFO_R_W,
+				data->fifo_buf, n * data->frame_len);
+	if (ret)
+		return ret;
+
+	for (i = 0; i < n; i++) {
+		memcpy(data->scan.channels, &data->fifo_buf[i * data->frame_len],
+		       data->frame_len);
+		iio_push_to_buffers_with_timestamp(indio_dev, &data->scan,
+						   now - (s64)(total - 1 - i) *
+						   data->fifo_period_ns);
+	}
+
+	return n;
+}
+
+static void mpu6050_fifo_work(struct work_struct *work)
+{
+	struct mpu6050_data *data = container_of(work, struct mpu6050_data,
+						 fifo_work.work);
+	unsigned long delay;
+
+	mutex_lock(&data->lock);
+	if (!data->fifo_enabled) {
+		mutex_unlock(&data->lock);
+		return;
+	}
+
+	mpu6050_fifo_drain(data->indio_dev, MPU6050_FIFO_MAX_FRAMES);
+	delay = nsecs_to_jiffies(data->watermark * data->fifo_period_ns);
+	mutex_unlock(&data->lock);
+
+	schedule_delayed_work(&data->fifo_work, max(delay, 1UL));
+}
+
+static int mpu6050_buffer_postenable(struct iio_dev *indio_dev)
+{
+	struct mpu6050_data *data = iio_priv(indio_dev);
+	int ret;
+
+	/* The FIFO is only used when no trigger is attached */
+	if (iio_device_get_current_mode(indio_dev) == INDIO_BUFFER_TRIGGERED)
+		return 0;
+
+	mutex_lock(&data->lock);
+
+	data->fifo_period_ns = mpu6050_samp_period_ns(data);
+
+	ret = regmap_write(data->regmap, MPU6050_REG_FIFO_EN, data->fifo_en);
+	if (ret)
+		goto out;
+
+	ret = regmap_update_bits(data->regmap, MPU6050_REG_INT_ENABLE,
+				 MPU6050_INT_FIFO_OFLOW,
+				 MPU6050_INT_FIFO_OFLOW);
+	if (ret)
+		goto out;
+
+	ret = mpu6050_fifo_reset(data);
+	if (ret)
+		goto out;
+
+	data->fifo_enabled = true;
+	schedule_delayed_work(&data->fifo_work,
+			      nsecs_to_jiffies(data->watermark *
+					       data->fifo_period_ns));
+out:
+	mutex_unlock(&data->lock);
+	return ret;
+}
+
+static int mpu6050_buffer_predisable(struct iio_dev *indio_dev)
+{
+	struct mpu6050_data *data = iio_priv(indio_dev);
+	int ret;
+
+	if (iio_device_get_current_mode(indio_dev) == INDIO_BUFFER_TRIGGERED)
+		return 0;
+
+	mutex_lock(&data->lock);
+	data->fifo_enabled = false;
+	mutex_unlock(&data->lock);
+
+	cancel_delayed_work_sync(&data->fifo_work);
+
+	mutex_lock(&data->lock);
+
+	/* Hand what is still queued over to userspace */
+	mpu6050_fifo_drain(indio_dev, MPU6050_FIFO_MAX_FRAMES);
+
+	ret = regmap_update_bits(data->regmap, MPU6050_REG_USER_CTRL,
+				 MPU6050_USER_CTRL_FIFO_EN, 0);
+	if (!ret)
+		ret = regmap_write(data->regmap, MPU6050_REG_FIFO_EN, 0);
+	if (!ret)
+		ret = regmap_update_bits(data->regmap, MPU6050_REG_INT_ENABLE,
+					 MPU6050_INT_FIFO_OFLOW, 0);
+
+	mutex_unlock(&data->lock);
+	return ret;
+}
+
+/*
+ * Every available scan mask is one run of data registers, accel and temp,
+ * gyro, or both: power just those sensors and read just that run.
+ */
+static void mpu6050_buffer_setup(struct mpu6050_data *data,
+				 const unsigned long *mask)
+{
+	bool accel = test_bit(MPU6050_SCAN_ACCEL_X, mask);
+	bool gyro = test_bit(MPU6050_SCAN_GYRO_X, mask);
+
+	data->buffer_blocks = 0;
+	data->frame_len = 0;
+	data->fifo_en = 0;
+
+	if (accel) {
+		data->buffer_blocks |= BIT(MPU6050_PWR_ACCEL);
+		data->frame_len += MPU6050_ACCEL_TEMP_LEN;
+		data->fifo_en |= MPU6050_FIFO_EN_ACCEL | MPU6050_FIFO_EN_TEMP;
+	}
+	if (gyro) {
+		data->buffer_blocks |= BIT(MPU6050_PWR_GYRO);
+		data->frame_len += MPU6050_GYRO_LEN;
+		data->fifo_en |= MPU6050_FIFO_EN_GYRO;
+	}
+
+	data->frame_reg = accel ? MPU6050_REG_ACCEL_XOUT_H :
+				  MPU6050_REG_GYRO_XOUT_H;
+}
+
+static int mpu6050_buffer_preenable(struct iio_dev *indio_dev)
+{
+	struct mpu6050_data *data = iio_priv(indio_dev);
+	int ret;
+
+	ret = mpu6050_pm_get(data);
+	if (ret)
+		return ret;
+
+	mutex_lock(&data->lock);
+	mpu6050_buffer_setup(data, indio_dev->active_scan_mask);
+	ret = mpu6050_power_get(data, data->buffer_blocks);
+	mutex_unlock(&data->lock);
+
+	if (ret)
+		mpu6050_pm_put(data);
+
+	return ret;
+}
+
+static int mpu6050_buffer_postdisable(struct iio_dev *indio_dev)
+{
+	struct mpu6050_data *data = iio_priv(indio_dev);
+	int ret;
+
+	mutex_lock(&data->lock);
+	ret = mpu6050_power_put(data, data->buffer_blocks);
+	mutex_unlock(&data->lock);
+
+	mpu6050_pm_put(data);
+	return ret;
+}
+
+static const struct iio_buffer_setup_ops mpu6050_buffer_ops = {
+	.preenable = mpu6050_buffer_preenable,
+	.postenable = mpu6050_buffer_postenable,
+	.predisable = mpu6050_buffer_predisable,
+	.postdisable = mpu6050_buffer_postdisable,
+};
+
+static int mpu6050_set_watermark(struct iio_dev *indio_dev, unsigned int val)
+{
+	struct mpu6050_data *data = iio_priv(indio_dev);
+
+	mutex_lock(&data->lock);
+	data->watermark = clamp_val(val, 1, MPU6050_FIFO_WATERMARK_MAX);
+	mutex_unlock(&data->lock);
+
+	return 0;
+}
+
+static int mpu6050_flush_to_buffer(struct iio_dev *indio_dev,
+				   unsigned int count)
+{
+	struct mpu6050_data *data = iio_priv(indio_dev);
+	int ret;
+
+	mutex_lock(&data->lock);
+	ret = data->fifo_enabled ? mpu6050_fifo_drain(indio_dev, count) : 0;
+	mutex_unlock(&data->lock);
+
+	return ret;
+}
+
+static ssize_t hwfifo_watermark_show(struct device *dev,
+				     struct device_attribute *attr, char *buf)
+{
+	struct mpu6050_data *data = iio_priv(dev_to_iio_dev(dev));
+
+	return sysfs_emit(buf, "%u\n", data->watermark);
+}
+
+static ssize_t hwfifo_enabled_show(struct device *dev,
+				   struct device_attribute *attr, char *buf)
+{
+	struct mpu6050_data *data = iio_priv(dev_to_iio_dev(dev));
+
+	return sysfs_emit(buf, "%d\n", data->fifo_enabled);
+}
+
+static ssize_t raw_snapshot_show(struct device *dev,
+				 struct device_attribute *attr, char *buf)
+{
+	struct mpu6050_data *data = iio_priv(dev_to_iio_dev(dev));
+
+	return sysfs_emit(buf, "%d\n", data->snapshot);
+}
+
+static ssize_t raw_snapshot_store(struct device *dev,
+				  struct device_attribute *attr,
+				  const char *buf, size_t len)
+{
+	struct mpu6050_data *data = iio_priv(dev_to_iio_dev(dev));
+	bool en;
+	int ret;
+
+	ret = kstrtobool(buf, &en);
+	if (ret)
+		return ret;
+
+	mutex_lock(&data->lock);
+	data->snapshot = en;
+	data->frame_ts = 0;
+	mutex_unlock(&data->lock);
+
+	return len;
+}
+
+static IIO_DEVICE_ATTR_RW(raw_snapshot, 0);
+
+static struct attribute *mpu6050_attributes[] = {
+	&iio_dev_attr_raw_snapshot.dev_attr.attr,
+	NULL
+};
+
+static const struct attribute_group mpu6050_attribute_group = {
+	.attrs = mpu6050_attributes,
+};
+
+static IIO_STATIC_CONST_DEVICE_ATTR(hwfifo_watermark_min, "1");
+static IIO_STATIC_CONST_DEVICE_ATTR(hwfifo_watermark_max,
+				    __stringify(MPU6050_FIFO_WATERMARK_MAX));
+static IIO_DEVICE_ATTR_RO(hwfifo_watermark, 0);
+static IIO_DEVICE_ATTR_RO(hwfifo_enabled, 0);
+
+static const struct iio_dev_attr *mpu6050_fifo_attributes[] = {
+	&iio_dev_attr_hwfifo_watermark_min,
+	&iio_dev_attr_hwfifo_watermark_max,
+	&iio_dev_attr_hwfifo_watermark,
+	&iio_dev_attr_hwfifo_enabled,
+	NULL
+};
+
+static unsigned int mpu6050_event_bit(enum iio_event_type type)
+{
+	switch (type) {
+	case IIO_EV_TYPE_MAG_ADAPTIVE:
+		return MPU6050_INT_MOT;
+	case IIO_EV_TYPE_ROC:
+		return MPU6050_INT_ZMOT;
+	default:
+		return 0;
+	}
+}
+
+static int mpu6050_read_event_config(struct iio_dev *indio_dev,
+				     const struct iio_chan_spec *chan,
+				     enum iio_event_type type,
+				     enum iio_event_direction dir)
+{
+	struct mpu6050_data *data = iio_priv(indio_dev);
+	unsigned int bit = mpu6050_event_bit(type);
+
+	if (!bit)
+		return -EINVAL;
+
+	return !!(READ_ONCE(data->events) & bit);
+}
+
+static int mpu6050_write_event_config(struct iio_dev *indio_dev,
+				      const struct iio_chan_spec *chan,
+				      enum iio_event_type type,
+				      enum iio_event_direction dir, int state)
+{
+	struct mpu6050_data *data = iio_priv(indio_dev);
+	unsigned int bit = mpu6050_event_bit(type);
+	bool enabled;
+	int ret;
+
+	if (!bit)
+		return -EINVAL;
+
+	ret = mpu6050_pm_get(data);
+	if (ret)
+		return ret;
+
+	mutex_lock(&data->lock);
+	enabled = data->events & bit;
+
+	/* The detectors run on accel data, keep it and the device up */
+	if (state && !enabled) {
+		ret = mpu6050_power_get(data, BIT(MPU6050_PWR_MOTION));
+		if (ret)
+			goto out;
+	}
+
+	ret = regmap_update_bits(data->regmap, MPU6050_REG_INT_ENABLE, bit,
+				 state ? bit : 0);
+
+	if (state && !enabled) {
+		if (ret) {
+			mpu6050_power_put(data, BIT(MPU6050_PWR_MOTION));
+		} else {
+			WRITE_ONCE(data->events, data->events | bit);
+			pm_runtime_get_noresume(data->dev);
+		}
+	} else if (!state && enabled && !ret) {
+		WRITE_ONCE(data->events, data->events & ~bit);
+		mpu6050_power_put(data, BIT(MPU6050_PWR_MOTION));
+		pm_runtime_put_noidle(data->dev);
+	}
+
+out:
+	mutex_unlock(&data->lock);
+	mpu6050_pm_put(data);
+	return ret;
+}
+
+/*
+ * Threshold in m/s^2, duration in seconds. Both registers are plain 8 bit
+ * counts, served from the regmap cache on read: probe fills it.
+ */
+static int mpu6050_event_reg(enum iio_event_type type,
+			     enum iio_event_info info, unsigned int *unit)
+{
+	switch (info) {
+	case IIO_EV_INFO_VALUE:
+		*unit = MPU6050_MOT_THR_MICRO;
+		switch (type) {
+		case IIO_EV_TYPE_MAG_ADAPTIVE:
+			return MPU6050_REG_MOT_THR;
+		case IIO_EV_TYPE_ROC:
+			return MPU6050_REG_ZRMOT_THR;
+		default:
+			return -EINVAL;
+		}
+	case IIO_EV_INFO_PERIOD:
+		switch (type) {
+		case IIO_EV_TYPE_MAG_ADAPTIVE:
+			*unit = MPU6050_MOT_DUR_US;
+			return MPU6050_REG_MOT_DUR;
+		case IIO_EV_TYPE_ROC:
+			*unit = MPU6050_ZRMOT_DUR_US;
+			return MPU6050_REG_ZRMOT_DUR;
+		default:
+			return -EINVAL;
+		}
+	default:
+		return -EINVAL;
+	}
+}
+
+static int mpu6050_read_event_value(struct iio_dev *indio_dev,
+				    const struct iio_chan_spec *chan,
+				    enum iio_event_type type,
+				    enum iio_event_direction dir,
+				    enum iio_event_info info,
+				    int *val, int *val2)
+{
+	struct mpu6050_data *data = iio_priv(indio_dev);
+	unsigned int unit, raw, micro;
+	int reg, ret;
+
+	reg = mpu6050_event_reg(type, info, &unit);
+	if (reg < 0)
+		return reg;
+
+	ret = regmap_read(data->regmap, reg, &raw);
+	if (ret)
+		return ret;
+
+	micro = raw * unit;
+	*val = micro / MICRO;
+	*val2 = micro % MICRO;
+	return IIO_VAL_INT_PLUS_MICRO;
+}
+
+static int mpu6050_write_event_value(struct iio_dev *indio_dev,
+				     const struct iio_chan_spec *chan,
+				     enum iio_event_type type,
+				     enum iio_event_direction dir,
+				     enum iio_event_info info,
+				     int val, int val2)
+{
+	struct mpu6050_data *data = iio_priv(indio_dev);
+	unsigned int unit;
+	u64 raw;
+	int reg, ret;
+
+	reg = mpu6050_event_reg(type, info, &unit);
+	if (reg < 0)
+		return reg;
+
+	if (val < 0 || val2 < 0)
+		return -EINVAL;
+
+	raw = DIV_ROUND_CLOSEST_ULL((u64)val * MICRO + val2, unit);
+	if (raw > U8_MAX)
+		return -EINVAL;
+
+	mutex_lock(&data->lock);
+	ret = regmap_write(data->regmap, reg, raw);
+	mutex_unlock(&data->lock);
+
+	return ret;
+}
+
+static const struct iio_info mpu6050_info = {
+	.read_raw   = mpu6050_read_raw,
+	.write_raw  = mpu6050_write_raw,
+	.read_avail = mpu6050_read_avail,
+	.attrs      = &mpu6050_attribute_group,
+	.read_event_config  = mpu6050_read_event_config,
+	.write_event_config = mpu6050_write_event_config,
+	.read_event_value   = mpu6050_read_event_value,
+	.write_event_value  = mpu6050_write_event_value,
+	.hwfifo_set_watermark = mpu6050_set_watermark,
+	.hwfifo_flush_to_buffer = mpu6050_flush_to_buffer,
+};
+
+/* All data registers are big endian, 16 bit signed */
+#define MPU6050_SCAN_TYPE {						\
+	.sign = 's',							\
+	.realbits = 16,							\
+	.storagebits = 16,						\
+	.endianness = IIO_BE,						\
+}
+
+/* LP_WAKE_CTRL 0..3 follows "off" */
+static const char * const mpu6050_lp_wake_items[] = {
+	"off", "1.25", "5", "20", "40",
+};
+
+static int mpu6050_get_lp_wake(struct iio_dev *indio_dev,
+			       const struct iio_chan_spec *chan)
+{
+	struct mpu6050_data *data = iio_priv(indio_dev);
+
+	return READ_ONCE(data->lp_wake);
+}
+
+/* Takes effect whenever accel is used by the motion detectors only */
+static int mpu6050_set_lp_wake(struct iio_dev *indio_dev,
+			       const struct iio_chan_spec *chan,
+			       unsigned int mode)
+{
+	struct mpu6050_data *data = iio_priv(indio_dev);
+	int ret;
+
+	mutex_lock(&data->lock);
+	WRITE_ONCE(data->lp_wake, mode);
+	ret = mpu6050_power_apply(data);
+	mutex_unlock(&data->lock);
+
+	return ret;
+}
+
+static const struct iio_enum mpu6050_lp_wake_enum = {
+	.items = mpu6050_lp_wake_items,
+	.num_items = ARRAY_SIZE(mpu6050_lp_wake_items),
+	.get = mpu6050_get_lp_wake,
+	.set = mpu6050_set_lp_wake,
+};
+
+static const struct iio_chan_spec_ext_info mpu6050_accel_ext_info[] = {
+	IIO_ENUM("lp_wake_frequency", IIO_SHARED_BY_TYPE,
+		 &mpu6050_lp_wake_enum),
+	IIO_ENUM_AVAILABLE("lp_wake_frequency", IIO_SHARED_BY_TYPE,
+			   &mpu6050_lp_wake_enum),
+	{ }
+};
+
+/*
+ * Motion: |high-passed accel| above MOT_THR on any axis for MOT_DUR.
+ * Zero motion: below ZRMOT_THR on all axes for ZRMOT_DUR, rising when it
+ * starts and falling when it ends. The chip has one enable for each, so
+ * everything is shared by the accel channels.
+ */
+static const struct iio_event_spec mpu6050_motion_events[] = {
+	{
+		.type = IIO_EV_TYPE_MAG_ADAPTIVE,
+		.dir = IIO_EV_DIR_RISING,
+		.mask_shared_by_type = BIT(IIO_EV_INFO_ENABLE) |
+			BIT(IIO_EV_INFO_VALUE) | BIT(IIO_EV_INFO_PERIOD),
+	}, {
+		.type = IIO_EV_TYPE_ROC,
+		.dir = IIO_EV_DIR_RISING,
+		.mask_shared_by_type = BIT(IIO_EV_INFO_ENABLE) |
+			BIT(IIO_EV_INFO_VALUE) | BIT(IIO_EV_INFO_PERIOD),
+	}, {
+		.type = IIO_EV_TYPE_ROC,
+		.dir = IIO_EV_DIR_FALLING,
+	},
+};
+
+#define MPU6050_ACCEL_CHANNEL(_axis) {					\
+	.type = IIO_ACCEL,						\
+	.modified = 1,							\
+	.channel2 = IIO_MOD_##_axis,					\
+	.info_mask_separate = BIT(IIO_CHAN_INFO_RAW),			\
+	.info_mask_shared_by_type = BIT(IIO_CHAN_INFO_SCALE) |		\
+		BIT(IIO_CHAN_INFO_SAMP_FREQ) |				\
+		BIT(IIO_CHAN_INFO_LOW_PASS_FILTER_3DB_FREQUENCY),	\
+	.info_mask_shared_by_type_available = BIT(IIO_CHAN_INFO_SCALE) | \
+		BIT(IIO_CHAN_INFO_SAMP_FREQ) |				\
+		BIT(IIO_CHAN_INFO_LOW_PASS_FILTER_3DB_FREQUENCY),	\
+	.scan_index = MPU6050_SCAN_ACCEL_##_axis,			\
+	.scan_type = MPU6050_SCAN_TYPE,					\
+	.ext_info = mpu6050_accel_ext_info,				\
+	.event_spec = mpu6050_motion_events,				\
+	.num_event_specs = ARRAY_SIZE(mpu6050_motion_events),		\
+}
+
+#define MPU6050_GYRO_CHANNEL(_axis) {					\
+	.type = IIO_ANGL_VEL,						\
+	.modified = 1,							\
+	.channel2 = IIO_MOD_##_axis,					\
+	.info_mask_separate = BIT(IIO_CHAN_INFO_RAW),			\
+	.info_mask_shared_by_type = BIT(IIO_CHAN_INFO_SCALE) |		\
+		BIT(IIO_CHAN_INFO_SAMP_FREQ) |				\
+		BIT(IIO_CHAN_INFO_LOW_PASS_FILTER_3DB_FREQUENCY),	\
+	.info_mask_shared_by_type_available = BIT(IIO_CHAN_INFO_SCALE) | \
+		BIT(IIO_CHAN_INFO_SAMP_FREQ) |				\
+		BIT(IIO_CHAN_INFO_LOW_PASS_FILTER_3DB_FREQUENCY),	\
+	.scan_index = MPU6050_SCAN_GYRO_##_axis,			\
+	.scan_type = MPU6050_SCAN_TYPE,					\
+}
+
+static const struct iio_chan_spec mpu6050_channels[] = {
+	MPU6050_ACCEL_CHANNEL(X),
 	MPU6050_ACCEL_CHANNEL(Y),
 	MPU6050_ACCEL_CHANNEL(Z),
 
+	{
+		.type = IIO_TEMP,
+		.info_mask_separate = BIT(IIO_CHAN_INFO_RAW) |
+			BIT(IIO_CHAN_INFO_SCALE) |
+			BIT(IIO_CHAN_INFO_OFFSET),
+		.scan_index = MPU6050_SCAN_TEMP,
+		.scan_type = MPU6050_SCAN_TYPE,
+	},
+
 	MPU6050_GYRO_CHANNEL(X),
 	MPU6050_GYRO_CHANNEL(Y),
 	MPU6050_GYRO_CHANNEL(Z),
+
+	IIO_CHAN_SOFT_TIMESTAMP(MPU6050_SCAN_TIMESTAMP),
+};
+
+/*
+ * Accel with temp and gyro alone leave the other sensor in standby; any
+ * other mix reads the whole 14-byte block. The IIO core picks the
+ * channels userspace asked for out of it.
+ */
+static const unsigned long mpu6050_scan_masks[] = {
+	GENMASK(MPU6050_SCAN_TEMP, MPU6050_SCAN_ACCEL_X),
+	GENMASK(MPU6050_SCAN_GYRO_Z, MPU6050_SCAN_GYRO_X),
+	GENMASK(MPU6050_SCAN_GYRO_Z, MPU6050_SCAN_ACCEL_X),
+	0
+};
+
+static irqreturn_t mpu6050_trigger_handler(int irq, void *p)
+{
+	struct iio_poll_func *pf = p;
+	struct iio_dev *indio_dev = pf->indio_dev;
+	struct mpu6050_data *data = iio_priv(indio_dev);
+	int ret;
+
+	/* The registers of the buffered sensors in one burst */
+	mutex_lock(&data->lock);
+	ret = regmap_bulk_read(data->regmap, data->frame_reg,
+			       data->scan.channels, data->frame_len);
+	mutex_unlock(&data->lock);
+	if (ret)
+		goto done;
+
+	iio_push_to_buffers_with_timestamp(indio_dev, &data->scan,
+					   pf->timestamp);
+
+done:
+	iio_trigger_notify_done(indio_dev->trig);
+	return IRQ_HANDLED;
+}
+
+static int mpu6050_drdy_set_state(struct iio_trigger *trig, bool state)
+{
+	struct iio_dev *indio_dev = iio_trigger_get_drvdata(trig);
+	struct mpu6050_data *data = iio_priv(indio_dev);
+	int ret;
+
+	mutex_lock(&data->lock);
+	ret = regmap_update_bits(data->regmap, MPU6050_REG_INT_ENABLE,
+				 MPU6050_INT_DATA_RDY,
+				 state ? MPU6050_INT_DATA_RDY : 0);
+	if (!ret)
+		WRITE_ONCE(data->drdy_enabled, state);
+	mutex_unlock(&data->lock);
+
+	return ret;
+}
+
+static const struct iio_trigger_ops mpu6050_trigger_ops = {
+	.set_trigger_state = mpu6050_drdy_set_state,
+	.validate_device = iio_trigger_validate_own_device,
 };
 
-int mpu6050_core_probe(struct device *dev, struct regmap *regmap)
+/*
+ * Data ready trigger on the INT pin. Without an interrupt in DT any other
+ * trigger, e.g. an iio-trig-hrtimer instance, drives the buffer instead.
+ */
+/*
+ * The INT pulse does not tell its source. Data ready is handed to the
+ * trigger right here, motion interrupts need INT_STATUS read over the bus.
+ */
+static irqreturn_t mpu6050_irq_handler(int irq, void *private)
+{
+	struct iio_dev *indio_dev = private;
+	struct mpu6050_data *data = iio_priv(indio_dev);
+
+	if (READ_ONCE(data->drdy_enabled))
+		iio_trigger_poll(data->trig);
+
+	if (READ_ONCE(data->events))
+		return IRQ_WAKE_THREAD;
+
+	return IRQ_HANDLED;
+}
+
+static irqreturn_t mpu6050_irq_thread_handler(int irq, void *private)
+{
+	struct iio_dev *indio_dev = private;
+	struct mpu6050_data *data = iio_priv(indio_dev);
+
+	mutex_lock(&data->lock);
+	mpu6050_read_int_status(indio_dev);
+	mutex_unlock(&data->lock);
+
+	return IRQ_HANDLED;
+}
+
+static int mpu6050_trigger_probe(struct device *dev, struct iio_dev *indio_dev,
+				 int irq)
+{
+	struct mpu6050_data *data = iio_priv(indio_dev);
+	unsigned int pin_cfg = 0;
+	unsigned long irq_type;
+	int ret;
+
+	irq_type = irq_get_trigger_type(irq);
+	switch (irq_type) {
+	case IRQF_TRIGGER_FALLING:
+		pin_cfg = MPU6050_INT_LEVEL_LOW;
+		break;
+	case IRQF_TRIGGER_NONE:
+		irq_type = IRQF_TRIGGER_RISING;
+		break;
+	case IRQF_TRIGGER_RISING:
+		break;
+	default:
+		/* 50us pulses, only an edge catches them reliably */
+		return dev_err_probe(dev, -EINVAL,
+				     "INT must be an edge triggered interrupt\n");
+	}
+
+	/* Push-pull, 50us pulse per sample, no status read needed to clear */
+	ret = regmap_write(data->regmap, MPU6050_REG_INT_PIN_CFG, pin_cfg);
+	if (ret)
+		return ret;
+
+	ret = regmap_write(data->regmap, MPU6050_REG_INT_ENABLE, 0);
+	if (ret)
+		return ret;
+
+	data->trig = devm_iio_trigger_alloc(dev, "%s-dev%d", indio_dev->name,
+					    iio_device_id(indio_dev));
+	if (!data->trig)
+		return -ENOMEM;
+
+	data->trig->ops = &mpu6050_trigger_ops;
+	iio_trigger_set_drvdata(data->trig, indio_dev);
+
+	/* Not oneshot, data ready pulses must not be masked by the thread */
+	ret = devm_request_threaded_irq(dev, irq, mpu6050_irq_handler,
+					mpu6050_irq_thread_handler, irq_type,
+					indio_dev->name, indio_dev);
+	if (ret)
+		return ret;
+
+	ret = devm_iio_trigger_register(dev, data->trig);
+	if (ret)
+		return ret;
+
+	indio_dev->trig = iio_trigger_get(data->trig);
+	return 0;
+}
+
+/* Motion interrupts need INT wired up, hide the events without it */
+static int mpu6050_strip_events(struct device *dev, struct iio_dev *indio_dev)
+{
+	struct iio_chan_spec *chans;
+	unsigned int i;
+
+	chans = devm_kmemdup(dev, mpu6050_channels, sizeof(mpu6050_channels),
+			     GFP_KERNEL);
+	if (!chans)
+		return -ENOMEM;
+
+	for (i = 0; i < ARRAY_SIZE(mpu6050_channels); i++) {
+		chans[i].event_spec = NULL;
+		chans[i].num_event_specs = 0;
+	}
+
+	indio_dev->channels = chans;
+	return 0;
+}
+
+int mpu6050_core_probe(struct device *dev, struct regmap *regmap, int irq)
 {
 	struct iio_dev *indio_dev;
 	struct mpu6050_data *data;
-	unsigned int chip_id;
+	unsigned int chip_id, reg, val;
 	int ret;
 
 	indio_dev = devm_iio_device_alloc(dev, sizeof(*data));
@@ -364,8 +1545,17 @@ int mpu6050_core_probe(struct device *dev, struct regmap *regmap)
 		return -ENOMEM;
 
 	data = iio_priv(indio_dev);
+	data->dev = dev;
+	data->indio_dev = indio_dev;
 	data->regmap = regmap;
+	data->watermark = 1;
 	mutex_init(&data->lock);
+	INIT_DELAYED_WORK(&data->fifo_work, mpu6050_fifo_work);
+	INIT_DELAYED_WORK(&data->raw_work, mpu6050_raw_work);
+
+	ret = devm_add_action_or_reset(dev, mpu6050_cancel_raw_work, data);
+	if (ret)
+		return ret;
 
 	/* WHO_AM_I */
 	ret = regmap_read(regmap, MPU6050_REG_WHO_AM_I, &chip_id);
@@ -375,27 +1565,34 @@ int mpu6050_core_probe(struct device *dev, struct regmap *regmap)
 	if (chip_id != MPU6050_CHIP_ID)
 		return -ENODEV;
 
-	/*
-	 * Wake up + select clock source (PLL with X axis gyroscope).
-	 * 0x01 is common stable choice.
-	 */
-	ret = regmap_write(regmap, MPU6050_REG_PWR_MGMT_1, 0x01);
+	dev_set_drvdata(dev, indio_dev);
+
+	/* Out of sleep, each sensor stays in standby until it has a user */
+	ret = mpu6050_power_apply(data);
 	if (ret)
 		return ret;
 
-	/* CONFIG: DLPF_CFG=3 (typical) -> base rate assumed 1kHz */
-	ret = regmap_write(regmap, MPU6050_REG_CONFIG, 0x03);
+	/* CONFIG: DLPF_CFG=3 (typical) -> base rate 1kHz */
+	ret = regmap_write(regmap, MPU6050_REG_CONFIG,
+			   MPU6050_DLPF_CFG_DEFAULT);
 	if (ret)
 		return ret;
+	data->dlpf_cfg = MPU6050_DLPF_CFG_DEFAULT;
 
 	/* Default sample rate = 100Hz => div = 1000/100 - 1 = 9 */
 	ret = regmap_write(regmap, MPU6050_REG_SMPLRT_DIV, 9);
 	if (ret)
 		return ret;
+	data->smplrt_div = 9;
 
-	/* Default accel range: ±2g => FS_SEL=0 */
+	/*
+	 * Default accel range: ±2g => FS_SEL=0. The 5Hz high-pass removes
+	 * gravity for the motion detectors, the data registers bypass it.
+	 */
 	ret = regmap_update_bits(regmap, MPU6050_REG_ACCEL_CONFIG,
-				 MPU6050_FS_SEL_MASK, 0 << MPU6050_FS_SEL_SHIFT);
+				 MPU6050_FS_SEL_MASK | MPU6050_ACCEL_HPF_MASK,
+				 (0 << MPU6050_FS_SEL_SHIFT) |
+				 MPU6050_ACCEL_HPF_5HZ);
 	if (ret)
 		return ret;
 
@@ -405,14 +1602,152 @@ int mpu6050_core_probe(struct device *dev, struct regmap *regmap)
 	if (ret)
 		return ret;
 
+	/*
+	 * Nothing else touches the motion thresholds and durations before
+	 * the first autosuspend; read them into the cache so their event
+	 * values can be shown while the chip is asleep.
+	 */
+	for (reg = MPU6050_REG_MOT_THR; reg <= MPU6050_REG_ZRMOT_DUR; reg++) {
+		ret = regmap_read(regmap, reg, &val);
+		if (ret)
+			return ret;
+	}
+
 	indio_dev->name = "mpu6050";
 	indio_dev->modes = INDIO_DIRECT_MODE;
 	indio_dev->info = &mpu6050_info;
 	indio_dev->channels = mpu6050_channels;
 	indio_dev->num_channels = ARRAY_SIZE(mpu6050_channels);
+	indio_dev->available_scan_masks = mpu6050_scan_masks;
 
-	return devm_iio_device_register(dev, indio_dev);
+	if (irq > 0) {
+		ret = mpu6050_trigger_probe(dev, indio_dev, irq);
+		if (ret)
+			return ret;
+	} else {
+		ret = mpu6050_strip_events(dev, indio_dev);
+		if (ret)
+			return ret;
+	}
+
+	ret = devm_iio_triggered_buffer_setup_ext(dev, indio_dev,
+						  iio_pollfunc_store_time,
+						  mpu6050_trigger_handler,
+						  IIO_BUFFER_DIRECTION_IN,
+						  &mpu6050_buffer_ops,
+						  mpu6050_fifo_attributes);
+	if (ret)
+		return ret;
+
+	/* Buffer enabled without a trigger: drain the on-chip FIFO */
+	indio_dev->modes |= INDIO_BUFFER_SOFTWARE;
+
+	/* Held until registered, then autosuspend puts the chip to sleep */
+	pm_runtime_get_noresume(dev);
+	pm_runtime_set_active(dev);
+	pm_runtime_set_autosuspend_delay(dev, MPU6050_AUTOSUSPEND_DELAY_MS);
+	pm_runtime_use_autosuspend(dev);
+	ret = devm_pm_runtime_enable(dev);
+	if (ret) {
+		pm_runtime_put_noidle(dev);
+		return ret;
+	}
+
+	ret = devm_iio_device_register(dev, indio_dev);
+	if (ret) {
+		pm_runtime_put_noidle(dev);
+		return ret;
+	}
+
+	mpu6050_pm_put(data);
+	return 0;
 }
 EXPORT_SYMBOL_GPL(mpu6050_core_probe);
 
+/*
+ * Drop what raw reads kept running and put the chip to sleep. SLEEP goes
+ * around the cache, which keeps the active configuration for resume.
+ */
+static int mpu6050_core_runtime_suspend(struct device *dev)
+{
+	struct iio_dev *indio_dev = dev_get_drvdata(dev);
+	struct mpu6050_data *data = iio_priv(indio_dev);
+	unsigned int pwr1;
+	int ret;
+
+	ret = iio_device_suspend_triggering(indio_dev);
+	if (ret)
+		return ret;
+
+	mutex_lock(&data->lock);
+
+	/* Nothing to read them anymore, don't wait for raw_work */
+	mpu6050_raw_power_put(data);
+
+	ret = regmap_read(data->regmap, MPU6050_REG_PWR_MGMT_1, &pwr1);
+	if (ret)
+		goto out;
+
+	regcache_cache_bypass(data->regmap, true);
+	ret = regmap_write(data->regmap, MPU6050_REG_PWR_MGMT_1,
+			   pwr1 | MPU6050_PWR1_SLEEP);
+	regcache_cache_bypass(data->regmap, false);
+	if (ret)
+		goto out;
+
+	regcache_cache_only(data->regmap, true);
+out:
+	mutex_unlock(&data->lock);
+	return ret;
+}
+
+/*
+ * Registers survive SLEEP, so resume only clears it and pushes out what
+ * changed meanwhile. The only wait is the gyro start-up, and only if the
+ * gyro has a user.
+ */
+static int mpu6050_core_runtime_resume(struct device *dev)
+{
+	struct iio_dev *indio_dev = dev_get_drvdata(dev);
+	struct mpu6050_data *data = iio_priv(indio_dev);
+	unsigned long blocks = 0;
+	unsigned int pwr1, b;
+	int ret;
+
+	mutex_lock(&data->lock);
+	regcache_cache_only(data->regmap, false);
+
+	ret = regmap_read(data->regmap, MPU6050_REG_PWR_MGMT_1, &pwr1);
+	if (ret)
+		goto out;
+
+	regcache_cache_bypass(data->regmap, true);
+	ret = regmap_write(data->regmap, MPU6050_REG_PWR_MGMT_1, pwr1);
+	regcache_cache_bypass(data->regmap, false);
+	if (ret)
+		goto out;
+
+	ret = regcache_sync(data->regmap);
+	if (ret)
+		goto out;
+
+	for (b = 0; b < MPU6050_PWR_BLOCKS; b++)
+		if (data->pwr_refs[b])
+			blocks |= BIT(b);
+
+	mpu6050_power_wait(data, blocks);
+out:
+	mutex_unlock(&data->lock);
+	if (ret)
+		return ret;
+
+	return iio_device_resume_triggering(indio_dev);
+}
+
+const struct dev_pm_ops mpu6050_core_pm_ops = {
+	RUNTIME_PM_OPS(mpu6050_core_runtime_suspend,
+		       mpu6050_core_runtime_resume, NULL)
+};
+EXPORT_SYMBOL_GPL(mpu6050_core_pm_ops);
+
 MODULE_LICENSE("GPL");
\ No newline at end of file
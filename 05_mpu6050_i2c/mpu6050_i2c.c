@@ -1,12 +1,17 @@
 // SPDX-License-Identifier: GPL-2.0
 #include <linux/module.h>
 #include <linux/i2c.h>
+#include <linux/pm.h>
 #include <linux/regmap.h>
 #include "mpu6050.h"
 
 static const struct regmap_config mpu6050_regmap_config = {
 	.reg_bits = 8,
 	.val_bits = 8,
+	.max_register = MPU6050_MAX_REGISTER,
+	.volatile_table = &mpu6050_volatile_table,
+	.precious_table = &mpu6050_precious_table,
+	.cache_type = REGCACHE_MAPLE,
 };
 
 static int mpu6050_i2c_probe(struct i2c_client *client)
@@ -19,7 +24,7 @@ static int mpu6050_i2c_probe(struct i2c_client *client)
 		return PTR_ERR(regmap);
 
 	return mpu6050_core_probe(&client->dev,
-				  regmap);
+				  regmap, client->irq);
 }
 
 static const struct of_device_id mpu6050_of_match[] = {
@@ -32,6 +37,7 @@ static struct i2c_driver mpu6050_i2c_driver = {
 	.driver = {
 		.name = "mpu6050",
 		.of_match_table = mpu6050_of_match,
+		.pm = pm_ptr(&mpu6050_core_pm_ops),
 	},
 	.probe = mpu6050_i2c_probe,
 };
@@ -0,0 +1,197 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * KUnit comparison of the I2C and SPI transports. Both regmap configs run
+ * the 14-byte data burst against a stub bus that serves a register file
+ * and adds up the time each transfer takes on the wire: I2C at 400kHz,
+ * SPI at the clock mpu6050_spi_speed() picks for it. The CPU time of the
+ * regmap path is measured too; both are reported per burst.
+ */
+#include <kunit/device.h>
+#include <kunit/test.h>
+#include <linux/ktime.h>
+#include <linux/module.h>
+#include <linux/regmap.h>
+#include "mpu6050.h"
+
+#define MPU6050_TEST_BURSTS             1000
+#define MPU6050_TEST_I2C_HZ             400000
+/* START, address+W, register, repeated START, address+R, STOP */
+#define MPU6050_TEST_I2C_OVERHEAD_BITS  30
+/* Eight data bits and the ACK */
+#define MPU6050_TEST_I2C_BYTE_BITS      9
+
+struct mpu6050_test_bus {
+	u8 regs[MPU6050_MAX_REGISTER + 1];
+	bool spi;
+	unsigned int reads;
+	u64 wire_ns;
+};
+
+static u64 mpu6050_test_wire_ns(u64 bits, u32 hz)
+{
+	return div_u64(bits * NSEC_PER_SEC, hz);
+}
+
+static int mpu6050_test_bus_read(void *context, const void *reg_buf,
+				 size_t reg_size, void *val_buf,
+				 size_t val_size)
+{
+	struct mpu6050_test_bus *bus = context;
+	unsigned int reg = *(const u8 *)reg_buf;
+
+	if (bus->spi) {
+		/* regmap sets the read flag, the chip needs it */
+		if (!(reg & MPU6050_SPI_READ))
+			return -EIO;
+		reg &= ~MPU6050_SPI_READ;
+	}
+
+	if (reg + val_size > MPU6050_MAX_REGISTER + 1)
+		return -EINVAL;
+
+	if (bus->spi)
+		bus->wire_ns += mpu6050_test_wire_ns((reg_size + val_size) *
+						     BITS_PER_BYTE,
+						     mpu6050_spi_speed(reg,
+								       val_size));
+	else
+		bus->wire_ns += mpu6050_test_wire_ns(MPU6050_TEST_I2C_OVERHEAD_BITS +
+						     val_size *
+						     MPU6050_TEST_I2C_BYTE_BITS,
+						     MPU6050_TEST_I2C_HZ);
+
+	memcpy(val_buf, &bus->regs[reg], val_size);
+	bus->reads++;
+
+	return 0;
+}
+
+static int mpu6050_test_bus_write(void *context, const void *data,
+				  size_t count)
+{
+	struct mpu6050_test_bus *bus = context;
+	const u8 *buf = data;
+	unsigned int reg = buf[0];
+
+	if (count < 2 || reg + count - 1 > MPU6050_MAX_REGISTER + 1)
+		return -EINVAL;
+
+	memcpy(&bus->regs[reg], &buf[1], count - 1);
+
+	return 0;
+}
+
+static const struct regmap_bus mpu6050_test_regmap_bus = {
+	.read = mpu6050_test_bus_read,
+	.write = mpu6050_test_bus_write,
+};
+
+/* Same as the I2C transport */
+static const struct regmap_config mpu6050_test_i2c_config = {
+	.reg_bits = 8,
+	.val_bits = 8,
+	.max_register = MPU6050_MAX_REGISTER,
+	.volatile_table = &mpu6050_volatile_table,
+	.precious_table = &mpu6050_precious_table,
+	.cache_type = REGCACHE_MAPLE,
+};
+
+/* Same as the SPI transport */
+static const struct regmap_config mpu6050_test_spi_config = {
+	.reg_bits = 8,
+	.val_bits = 8,
+	.read_flag_mask = MPU6050_SPI_READ,
+	.max_register = MPU6050_MAX_REGISTER,
+	.volatile_table = &mpu6050_volatile_table,
+	.precious_table = &mpu6050_precious_table,
+	.cache_type = REGCACHE_MAPLE,
+};
+
+/* Average wire and CPU time of one data burst through either transport */
+static void mpu6050_test_burst(struct kunit *test, bool spi, u64 *wire_ns,
+			       u64 *cpu_ns)
+{
+	u8 burst[MPU6050_DATA_BURST_LEN];
+	struct mpu6050_test_bus *bus;
+	struct regmap *regmap;
+	struct device *dev;
+	unsigned int i;
+	u64 start;
+
+	bus = kunit_kzalloc(test, sizeof(*bus), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, bus);
+
+	bus->spi = spi;
+	for (i = 0; i < MPU6050_DATA_BURST_LEN; i++)
+		bus->regs[MPU6050_REG_ACCEL_XOUT_H + i] = i + 1;
+
+	dev = kunit_device_register(test, spi ? "mpu6000-test" :
+						"mpu6050-test");
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, dev);
+
+	regmap = devm_regmap_init(dev, &mpu6050_test_regmap_bus, bus,
+				  spi ? &mpu6050_test_spi_config :
+					&mpu6050_test_i2c_config);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, regmap);
+
+	start = ktime_get_ns();
+	for (i = 0; i < MPU6050_TEST_BURSTS; i++)
+		KUNIT_ASSERT_EQ(test, regmap_bulk_read(regmap,
+						       MPU6050_REG_ACCEL_XOUT_H,
+						       burst, sizeof(burst)), 0);
+	*cpu_ns = div_u64(ktime_get_ns() - start, MPU6050_TEST_BURSTS);
+	*wire_ns = div_u64(bus->wire_ns, MPU6050_TEST_BURSTS);
+
+	/* The data registers are volatile: every burst is one transfer */
+	KUNIT_EXPECT_EQ(test, bus->reads, MPU6050_TEST_BURSTS);
+	KUNIT_EXPECT_MEMEQ(test, burst, &bus->regs[MPU6050_REG_ACCEL_XOUT_H],
+			   sizeof(burst));
+}
+
+static void mpu6050_test_burst_throughput(struct kunit *test)
+{
+	u64 i2c_wire, i2c_cpu, spi_wire, spi_cpu;
+
+	mpu6050_test_burst(test, false, &i2c_wire, &i2c_cpu);
+	mpu6050_test_burst(test, true, &spi_wire, &spi_cpu);
+
+	kunit_info(test, "I2C: %llu ns on the wire, %llu ns CPU, %llu bursts/s\n",
+		   i2c_wire, i2c_cpu, div64_u64(NSEC_PER_SEC, i2c_wire));
+	kunit_info(test, "SPI: %llu ns on the wire, %llu ns CPU, %llu bursts/s\n",
+		   spi_wire, spi_cpu, div64_u64(NSEC_PER_SEC, spi_wire));
+
+	/* (30 + 14 * 9) bits at 400kHz, 15 * 8 bits at 20MHz */
+	KUNIT_EXPECT_EQ(test, i2c_wire, 390000);
+	KUNIT_EXPECT_EQ(test, spi_wire, 6000);
+}
+
+/* Only reads within INT_STATUS .. GYRO_ZOUT_L may run at 20MHz */
+static void mpu6050_test_spi_speed(struct kunit *test)
+{
+	KUNIT_EXPECT_EQ(test, mpu6050_spi_speed(MPU6050_REG_ACCEL_XOUT_H,
+						MPU6050_DATA_BURST_LEN),
+			MPU6050_SPI_DATA_HZ);
+	KUNIT_EXPECT_EQ(test, mpu6050_spi_speed(MPU6050_REG_INT_STATUS, 1),
+			MPU6050_SPI_DATA_HZ);
+	KUNIT_EXPECT_EQ(test, mpu6050_spi_speed(MPU6050_REG_CONFIG, 1),
+			MPU6050_SPI_CONF_HZ);
+	KUNIT_EXPECT_EQ(test, mpu6050_spi_speed(MPU6050_REG_GYRO_XOUT_H, 7),
+			MPU6050_SPI_CONF_HZ);
+	KUNIT_EXPECT_EQ(test, mpu6050_spi_speed(MPU6050_REG_FIFO_R_W,
+						MPU6050_DATA_BURST_LEN),
+			MPU6050_SPI_CONF_HZ);
+}
+
+static struct kunit_case mpu6050_test_cases[] = {
+	KUNIT_CASE(mpu6050_test_burst_throughput),
+	KUNIT_CASE(mpu6050_test_spi_speed),
+	{ }
+};
+
+static struct kunit_suite mpu6050_test_suite = {
+	.name = "mpu6050_transport",
+	.test_cases = mpu6050_test_cases,
+};
+kunit_test_suite(mpu6050_test_suite);
+
+MODULE_LICENSE("GPL");
@@ -0,0 +1,103 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <linux/module.h>
+#include <linux/pm.h>
+#include <linux/spi/spi.h>
+#include <linux/regmap.h>
+#include "mpu6050.h"
+
+/* reg_buf and the data bursts are DMA-safe, so no bounce buffer needed */
+static int mpu6050_spi_read(void *context, const void *reg_buf,
+			    size_t reg_size, void *val_buf, size_t val_size)
+{
+	struct spi_device *spi = context;
+	unsigned int reg = *(const u8 *)reg_buf & ~MPU6050_SPI_READ;
+	u32 hz = mpu6050_spi_speed(reg, val_size);
+	struct spi_transfer xfers[] = {
+		{
+			.tx_buf = reg_buf,
+			.len = reg_size,
+			.speed_hz = hz,
+		},
+		{
+			.rx_buf = val_buf,
+			.len = val_size,
+			.speed_hz = hz,
+		},
+	};
+
+	return spi_sync_transfer(spi, xfers, ARRAY_SIZE(xfers));
+}
+
+/* Writes only ever go to configuration registers */
+static int mpu6050_spi_write(void *context, const void *data, size_t count)
+{
+	struct spi_device *spi = context;
+	struct spi_transfer xfer = {
+		.tx_buf = data,
+		.len = count,
+		.speed_hz = MPU6050_SPI_CONF_HZ,
+	};
+
+	return spi_sync_transfer(spi, &xfer, 1);
+}
+
+static const struct regmap_bus mpu6050_spi_regmap_bus = {
+	.read = mpu6050_spi_read,
+	.write = mpu6050_spi_write,
+};
+
+static const struct regmap_config mpu6050_spi_regmap_config = {
+	.reg_bits = 8,
+	.val_bits = 8,
+	.read_flag_mask = MPU6050_SPI_READ,
+	.max_register = MPU6050_MAX_REGISTER,
+	.volatile_table = &mpu6050_volatile_table,
+	.precious_table = &mpu6050_precious_table,
+	.cache_type = REGCACHE_MAPLE,
+};
+
+static int mpu6050_spi_probe(struct spi_device *spi)
+{
+	struct regmap *regmap;
+	int ret;
+
+	regmap = devm_regmap_init(&spi->dev, &mpu6050_spi_regmap_bus,
+				  spi, &mpu6050_spi_regmap_config);
+	if (IS_ERR(regmap))
+		return PTR_ERR(regmap);
+
+	/* Keep the primary I2C interface from reacting to SPI traffic */
+	ret = regmap_update_bits(regmap, MPU6050_REG_USER_CTRL,
+				 MPU6050_USER_CTRL_I2C_IF_DIS,
+				 MPU6050_USER_CTRL_I2C_IF_DIS);
+	if (ret)
+		return ret;
+
+	return mpu6050_core_probe(&spi->dev, regmap, spi->irq);
+}
+
+static const struct spi_device_id mpu6050_spi_id[] = {
+	{ "mpu6000-minimal" },
+	{ }
+};
+MODULE_DEVICE_TABLE(spi, mpu6050_spi_id);
+
+static const struct of_device_id mpu6050_spi_of_match[] = {
+	{ .compatible = "mycompany,mpu6000-minimal" },
+	{ }
+};
+MODULE_DEVICE_TABLE(of, mpu6050_spi_of_match);
+
+static struct spi_driver mpu6050_spi_driver = {
+	.driver = {
+		.name = "mpu6000",
+		.of_match_table = mpu6050_spi_of_match,
+		.pm = pm_ptr(&mpu6050_core_pm_ops),
+	},
+	.probe = mpu6050_spi_probe,
+	.id_table = mpu6050_spi_id,
+};
+
+module_spi_driver(mpu6050_spi_driver);
+
+MODULE_LICENSE("GPL");